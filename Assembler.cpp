@@ -0,0 +1,662 @@
+#include "Assembler.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+
+// Encodings of one mnemonic, MOV has the most
+static const size_t maxCandidates = 64;
+
+static const char *regs8[] = {"AL", "CL", "DL", "BL", "AH", "CH", "DH", "BH"};
+static const char *regs16[] = {"AX", "CX", "DX", "BX", "SP", "BP", "SI", "DI"};
+static const char *sregs[] = {"ES", "CS", "SS", "DS"};
+
+enum class ArgKind : uint8_t { REG8, REG16, SREG, ST, STREG, IMM, MEM, CONST };
+
+// One operand as the listing prints it
+struct Arg {
+    ArgKind kind;
+    Width width;  // IMM and MEM, NONE for "MEM [...]"
+    uint32_t val; // register number, immediate or constant
+
+    // MEM, the ModRM fields it needs
+    bool direct; // [0x1234]
+    uint8_t rm;
+    Width dispWidth;
+    uint16_t disp;
+};
+
+static uint32_t hashName(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)toupper((unsigned char)name[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+static bool sameName(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (toupper((unsigned char)a[i]) != b[i]) {
+            return false;
+        }
+    }
+
+    return b[len] == '\0';
+}
+
+Assembler::Assembler() {
+    for (size_t i = 0; i < opsCount; i++) {
+        order.push_back((uint16_t)i);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](uint16_t a, uint16_t b) {
+        return strcmp(ops[a].name, ops[b].name) < 0;
+    });
+
+    size_t names = 0;
+
+    for (size_t i = 0; i < order.size(); i++) {
+        names += i == 0 || strcmp(ops[order[i - 1]].name,
+                                  ops[order[i]].name) != 0;
+    }
+
+    size_t capacity = 1;
+
+    while (capacity < names * 2) {
+        capacity *= 2;
+    }
+
+    slots.resize(capacity);
+
+    for (size_t begin = 0; begin < order.size();) {
+        const char *name = ops[order[begin]].name;
+        size_t end = begin;
+
+        while (end < order.size() && strcmp(ops[order[end]].name, name) == 0) {
+            end++;
+        }
+
+        if (end - begin > maxCandidates) {
+            printf("Too many encodings of %s\n", name);
+            throw -1;
+        }
+
+        const uint32_t hash = hashName(name, strlen(name));
+        size_t s = hash & (capacity - 1);
+
+        while (slots[s].end != 0) {
+            s = (s + 1) & (capacity - 1);
+        }
+
+        slots[s] = {hash, (uint16_t)begin, (uint16_t)end};
+        begin = end;
+    }
+}
+
+const Assembler::Slot *Assembler::find(const char *name, size_t len,
+                                       uint32_t hash) const {
+    const size_t mask = slots.size() - 1;
+
+    for (size_t s = hash & mask; slots[s].end != 0; s = (s + 1) & mask) {
+        const Slot &slot = slots[s];
+
+        if (slot.hash == hash &&
+            sameName(name, ops[order[slot.begin]].name, len)) {
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+static const char *skipSpace(const char *p, const char *end) {
+    while (p < end && isspace((unsigned char)*p)) {
+        p++;
+    }
+
+    return p;
+}
+
+// Length of the identifier or number at p
+static size_t wordLen(const char *p, const char *end) {
+    const char *q = p;
+
+    while (q < end && isalnum((unsigned char)*q)) {
+        q++;
+    }
+
+    return q - p;
+}
+
+static int findName(const char *const *names, size_t count, const char *p,
+                    size_t len) {
+    for (size_t i = 0; i < count; i++) {
+        if (sameName(p, names[i], len)) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+// "0x" and up to 8 hex digits, digits is how many were written
+static bool parseHexNum(const char *p, size_t len, uint32_t &val,
+                        size_t &digits) {
+    if (len < 3 || p[0] != '0' || (p[1] != 'x' && p[1] != 'X') || len > 10) {
+        return false;
+    }
+
+    val = 0;
+    digits = len - 2;
+
+    for (size_t i = 2; i < len; i++) {
+        const char c = (char)toupper((unsigned char)p[i]);
+
+        if (!isxdigit((unsigned char)c)) {
+            return false;
+        }
+
+        val = val * 16 + (uint32_t)(isdigit((unsigned char)c) ? c - '0'
+                                                              : c - 'A' + 10);
+    }
+
+    return true;
+}
+
+// The inside of [...]: a hex address, or BX/BP and SI/DI with an optional
+// hex displacement, joined by '+'
+static bool parseMem(const char *p, const char *end, Arg &arg) {
+    int base = -1;  // 0 BX, 1 BP
+    int index = -1; // 0 SI, 1 DI
+    bool hasDisp = false;
+    size_t digits = 0;
+    uint32_t disp = 0;
+
+    for (;;) {
+        p = skipSpace(p, end);
+        const size_t len = wordLen(p, end);
+
+        if (len == 0 || hasDisp) {
+            return false;
+        }
+
+        if (sameName(p, "BX", len) || sameName(p, "BP", len)) {
+            if (base != -1) {
+                return false;
+            }
+
+            base = sameName(p, "BP", len);
+        } else if (sameName(p, "SI", len) || sameName(p, "DI", len)) {
+            if (index != -1) {
+                return false;
+            }
+
+            index = sameName(p, "DI", len);
+        } else if (parseHexNum(p, len, disp, digits) && disp <= 0xFFFF) {
+            hasDisp = true;
+        } else {
+            return false;
+        }
+
+        p = skipSpace(p + len, end);
+
+        if (p == end) {
+            break;
+        }
+
+        if (*p != '+') {
+            return false;
+        }
+
+        p++;
+    }
+
+    arg.disp = (uint16_t)disp;
+
+    if (base == -1 && index == -1) {
+        arg.direct = true;
+        arg.rm = 0b110;
+        arg.dispWidth = Width::WORD;
+        return true;
+    }
+
+    if (base != -1 && index != -1) {
+        arg.rm = (uint8_t)(base * 2 + index);
+    } else if (index != -1) {
+        arg.rm = (uint8_t)(4 + index);
+    } else {
+        arg.rm = base ? 0b110 : 0b111;
+    }
+
+    // As printed: two digits are a byte, more a word
+    arg.dispWidth = !hasDisp    ? Width::NONE
+                    : digits <= 2 ? Width::BYTE
+                                  : Width::WORD;
+
+    // [BP] without displacement is the direct address encoding
+    return !(arg.rm == 0b110 && arg.dispWidth == Width::NONE);
+}
+
+static bool parseArg(const char *p, const char *end, Arg &arg) {
+    arg = Arg{};
+
+    p = skipSpace(p, end);
+
+    while (end > p && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+
+    const size_t len = wordLen(p, end);
+
+    if (len == 0) {
+        return false;
+    }
+
+    static const char *widths[] = {"MEM", "BYTE", "WORD", "DWORD", "QWORD"};
+    static const Width widthOf[] = {Width::NONE, Width::BYTE, Width::WORD,
+                                    Width::DWORD, Width::QWORD};
+
+    const int w = findName(widths, 5, p, len);
+
+    if (w >= 0) {
+        arg.width = widthOf[w];
+        p = skipSpace(p + len, end);
+
+        if (p < end && *p == '[') {
+            if (end[-1] != ']') {
+                return false;
+            }
+
+            arg.kind = ArgKind::MEM;
+            return parseMem(p + 1, end - 1, arg);
+        }
+
+        size_t digits;
+        const uint32_t max = arg.width == Width::BYTE   ? 0xFF
+                             : arg.width == Width::WORD ? 0xFFFF
+                                                        : 0xFFFFFFFF;
+
+        arg.kind = ArgKind::IMM;
+        return (arg.width == Width::BYTE || arg.width == Width::WORD ||
+                arg.width == Width::DWORD) &&
+               parseHexNum(p, end - p, arg.val, digits) && arg.val <= max;
+    }
+
+    if (p + len != end) {
+        return false;
+    }
+
+    int reg;
+
+    if ((reg = findName(regs8, 8, p, len)) >= 0) {
+        arg.kind = ArgKind::REG8;
+    } else if ((reg = findName(regs16, 8, p, len)) >= 0) {
+        arg.kind = ArgKind::REG16;
+    } else if ((reg = findName(sregs, 4, p, len)) >= 0) {
+        arg.kind = ArgKind::SREG;
+    } else if (sameName(p, "ST", len)) {
+        arg.kind = ArgKind::ST;
+        reg = 0;
+    } else if (len == 3 && toupper((unsigned char)p[0]) == 'S' &&
+               toupper((unsigned char)p[1]) == 'T' && p[2] >= '0' &&
+               p[2] <= '7') {
+        arg.kind = ArgKind::STREG;
+        reg = p[2] - '0';
+    } else if (len <= 3 && isdigit((unsigned char)p[0])) {
+        // CONSTBYTE, printed in decimal
+        arg.kind = ArgKind::CONST;
+        reg = 0;
+
+        for (size_t i = 0; i < len; i++) {
+            if (!isdigit((unsigned char)p[i])) {
+                return false;
+            }
+
+            reg = reg * 10 + (p[i] - '0');
+        }
+    } else {
+        return false;
+    }
+
+    arg.val = (uint32_t)reg;
+    return true;
+}
+
+// The ModRM fields of an r/m operand of the given width
+static bool setRM(const Arg &arg, Width width, uint8_t &mod, uint8_t &rm,
+                  Width &dispWidth, uint16_t &disp) {
+    const ArgKind reg = width == Width::BYTE ? ArgKind::REG8 : ArgKind::REG16;
+
+    if (arg.kind == reg) {
+        mod = 0b11;
+        rm = (uint8_t)arg.val;
+        return true;
+    }
+
+    if (arg.kind != ArgKind::MEM || arg.width != width) {
+        return false;
+    }
+
+    // [0x1234] is mod 00 with a word displacement
+    mod = arg.direct                     ? 0b00
+          : arg.dispWidth == Width::BYTE ? 0b01
+          : arg.dispWidth == Width::WORD ? 0b10
+                                         : 0b00;
+    rm = arg.rm;
+    dispWidth = arg.dispWidth;
+    disp = arg.disp;
+    return true;
+}
+
+// Bytes of op with args as its operands, false if they do not fit it
+static bool encode(const Op &op, const Arg *args, size_t argCount,
+                   Encoding &encoding) {
+    const Description &description = *op.description;
+
+    bool hasModRM = false;
+    uint8_t mod = 0;
+    uint8_t reg = op.opExt != OPExt::NONE ? op.n : 0;
+    uint8_t rm = 0;
+    Width dispWidth = Width::NONE;
+    uint16_t disp = 0;
+
+    // Immediates in the order of the operands
+    uint32_t imms[3];
+    size_t immLens[3];
+    size_t immCount = 0;
+
+    size_t i = 0;
+
+    for (; i < 3 && description.d[i].type != Type::NONE; i++) {
+        const D &d = description.d[i];
+
+        if (i >= argCount) {
+            return false;
+        }
+
+        const Arg &arg = args[i];
+        bool ok = false;
+
+        switch (d.type) {
+        case Type::RMB:
+            ok = setRM(arg, Width::BYTE, mod, rm, dispWidth, disp);
+            hasModRM = true;
+            break;
+        case Type::RMW:
+            ok = setRM(arg, Width::WORD, mod, rm, dispWidth, disp);
+            hasModRM = true;
+            break;
+        case Type::RMDW:
+            ok = setRM(arg, Width::DWORD, mod, rm, dispWidth, disp);
+            hasModRM = true;
+            break;
+        case Type::RMQW:
+            ok = setRM(arg, Width::QWORD, mod, rm, dispWidth, disp);
+            hasModRM = true;
+            break;
+        case Type::MEM:
+            ok = setRM(arg, Width::NONE, mod, rm, dispWidth, disp);
+            hasModRM = true;
+            break;
+        case Type::RB:
+            ok = arg.kind == ArgKind::REG8;
+            reg = (uint8_t)arg.val;
+            break;
+        case Type::RW:
+            ok = arg.kind == ArgKind::REG16;
+            reg = (uint8_t)arg.val;
+            break;
+        case Type::SEG:
+            ok = arg.kind == ArgKind::SREG;
+            reg = (uint8_t)arg.val;
+            break;
+        case Type::DB:
+        case Type::DW:
+        case Type::DDW: {
+            const Width width = d.type == Type::DB   ? Width::BYTE
+                                : d.type == Type::DW ? Width::WORD
+                                                     : Width::DWORD;
+
+            ok = arg.kind == ArgKind::IMM && arg.width == width;
+            imms[immCount] = arg.val;
+            immLens[immCount++] = (size_t)width;
+            break;
+        }
+        case Type::DEREFBYTEATDW:
+        case Type::DEREFWORDATDW:
+            ok = arg.kind == ArgKind::MEM && arg.direct &&
+                 arg.width == (d.type == Type::DEREFBYTEATDW ? Width::BYTE
+                                                             : Width::WORD);
+            imms[immCount] = arg.disp;
+            immLens[immCount++] = 2;
+            break;
+        case Type::REGB:
+            ok = arg.kind == ArgKind::REG8 && arg.val == d.num;
+            break;
+        case Type::REGW:
+            ok = arg.kind == ArgKind::REG16 && arg.val == d.num;
+            break;
+        case Type::CSEG:
+            ok = arg.kind == ArgKind::SREG && arg.val == d.num;
+            break;
+        case Type::CONSTBYTE:
+            ok = arg.kind == ArgKind::CONST && arg.val == d.num;
+            break;
+        case Type::ST:
+            ok = arg.kind == ArgKind::ST;
+            hasModRM = true;
+            break;
+        case Type::STREG:
+            ok = arg.kind == ArgKind::STREG;
+            mod = 0b11;
+            rm = (uint8_t)arg.val;
+            hasModRM = true;
+            break;
+        default:
+            break;
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    if (i != argCount) {
+        return false;
+    }
+
+    // FPU register forms only exist with mod 11
+    if (op.opExt == OPExt::FPU_11) {
+        mod = 0b11;
+    }
+
+    uint8_t *out = encoding.bytes;
+    size_t len = 0;
+
+    memcpy(out, op.code, op.codeSz);
+    len += op.codeSz;
+
+    if (hasModRM) {
+        out[len++] = (uint8_t)(mod << 6 | reg << 3 | rm);
+
+        for (size_t b = 0; b < (size_t)dispWidth; b++) {
+            out[len++] = (uint8_t)(disp >> (8 * b));
+        }
+    }
+
+    for (size_t n = 0; n < immCount; n++) {
+        for (size_t b = 0; b < immLens[n]; b++) {
+            out[len++] = (uint8_t)(imms[n] >> (8 * b));
+        }
+    }
+
+    encoding.len = (uint8_t)len;
+    encoding.op = &op;
+
+    // Only what the decoder reads back the same way, earlier entries of
+    // ops[] may claim the bytes
+    Instruction insn;
+    decodeOP(out, len, 0, insn);
+
+    return insn.status == Status::OP && insn.op == &op && insn.len == len &&
+           insn.hasModRM == hasModRM &&
+           (!hasModRM || (insn.reg == reg && insn.rm == rm &&
+                          (uint8_t)insn.mod == mod &&
+                          insn.dispWidth == dispWidth));
+}
+
+size_t Assembler::encodeAll(const char *text, Encoding *encodings,
+                            size_t max, AsmStatus &status) const {
+    const char *end = text + strlen(text);
+    const char *p = skipSpace(text, end);
+
+    // Mnemonics like "REP MOVSB" have two words
+    const size_t len1 = wordLen(p, end);
+    const char *second = skipSpace(p + len1, end);
+    const size_t len2 = wordLen(second, end);
+
+    const Slot *slot = nullptr;
+    const char *args = p + len1;
+
+    if (len2 > 0 && second > p + len1) {
+        char name[32];
+        const size_t len = len1 + 1 + len2;
+
+        if (len < sizeof(name)) {
+            memcpy(name, p, len1);
+            name[len1] = ' ';
+            memcpy(name + len1 + 1, second, len2);
+
+            slot = find(name, len, hashName(name, len));
+            args = second + len2;
+        }
+    }
+
+    if (!slot) {
+        slot = find(p, len1, hashName(p, len1));
+        args = p + len1;
+    }
+
+    if (len1 == 0 || !slot) {
+        status = AsmStatus::MNEMONIC;
+        return 0;
+    }
+
+    Arg parsed[3];
+    size_t argCount = 0;
+
+    args = skipSpace(args, end);
+
+    while (args < end) {
+        const char *comma = (const char *)memchr(args, ',', end - args);
+        const char *argEnd = comma ? comma : end;
+
+        if (argCount == 3 || !parseArg(args, argEnd, parsed[argCount])) {
+            status = AsmStatus::OPERANDS;
+            return 0;
+        }
+
+        argCount++;
+        args = comma ? comma + 1 : end;
+
+        if (comma && skipSpace(args, end) == end) {
+            status = AsmStatus::OPERANDS;
+            return 0;
+        }
+    }
+
+    Encoding found[maxCandidates];
+    size_t count = 0;
+
+    for (size_t i = slot->begin; i < slot->end; i++) {
+        if (encode(ops[order[i]], parsed, argCount, found[count])) {
+            count++;
+        }
+    }
+
+    std::stable_sort(found, found + count,
+                     [](const Encoding &a, const Encoding &b) {
+                         return a.len < b.len;
+                     });
+
+    std::copy(found, found + std::min(count, max), encodings);
+
+    status = count ? AsmStatus::OK : AsmStatus::OPERANDS;
+    return count;
+}
+
+AsmStatus Assembler::assemble(const char *text, size_t size,
+                              Encoding &encoding) const {
+    Encoding found[maxCandidates];
+    AsmStatus status;
+
+    const size_t count = encodeAll(text, found, maxCandidates, status);
+    const Encoding *chosen = nullptr;
+
+    for (size_t i = 0; i < count; i++) {
+        if (found[i].len != (size ? size : found[0].len)) {
+            continue;
+        }
+
+        if (!chosen) {
+            chosen = &found[i];
+            encoding = found[i];
+        } else if (memcmp(chosen->bytes, found[i].bytes, chosen->len) != 0) {
+            return AsmStatus::AMBIGUOUS;
+        }
+    }
+
+    if (chosen) {
+        return AsmStatus::OK;
+    }
+
+    return count ? AsmStatus::SIZE : status;
+}
+
+bool Assembler::roundTrips(const Instruction &insn,
+                           const uint8_t *bytes) const {
+    if (insn.status != Status::OP) {
+        return false;
+    }
+
+    Line line{};
+    line << insn.op->name;
+    printDescription(insn, line);
+
+    const std::string text(line.text, line.len);
+    Encoding encoding;
+
+    switch (assemble(text.c_str(), insn.len, encoding)) {
+    case AsmStatus::OK:
+        return memcmp(encoding.bytes, bytes, insn.len) == 0;
+    case AsmStatus::AMBIGUOUS:
+        break;
+    default:
+        return false;
+    }
+
+    Encoding found[maxCandidates];
+    AsmStatus status;
+    const size_t count = encodeAll(text.c_str(), found, maxCandidates, status);
+
+    for (size_t i = 0; i < count; i++) {
+        if (found[i].len == insn.len &&
+            memcmp(found[i].bytes, bytes, insn.len) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
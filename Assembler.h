@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+
+struct Encoding {
+    uint8_t bytes[maxOPLen];
+    uint8_t len;
+    const Op *op;
+};
+
+enum class AsmStatus : uint8_t {
+    OK,
+    MNEMONIC, // no entry of ops[] has it
+    OPERANDS, // not operands as the listing prints them, or none fit
+    SIZE,     // encodable, but not in the requested size
+    AMBIGUOUS // several encodings of that size, which ops[] prints the same
+};
+
+// Turns an instruction as the listing prints it ("MOV AX, WORD 0x011C")
+// back into bytes, using ops[] and the descriptions the decoder uses.
+// Operand widths are taken from the text: "BYTE 0x12" is an immediate byte,
+// "[BX + 0x12]" a byte and "[BX + 0x0012]" a word displacement, so the only
+// choice left is between entries of ops[] which print the same, like
+// "ADD AX, WORD 0x0001" as 05 or 81 /0. Every encoding is decoded again and
+// only kept if the decoder picks the same entry. Lookups do not allocate.
+class Assembler {
+  public:
+    Assembler();
+
+    // All encodings of text, shortest first, entries of the same length in
+    // the order of ops[]. Returns their number, at most max are stored.
+    size_t encodeAll(const char *text, Encoding *encodings, size_t max,
+                     AsmStatus &status) const;
+
+    // The encoding of exactly size bytes, or the shortest one for size 0.
+    // AMBIGUOUS if there are different bytes to choose from, like C3 and CB
+    // for "RET", encoding is the first of them then.
+    AsmStatus assemble(const char *text, size_t size,
+                       Encoding &encoding) const;
+
+    // Whether the listed text of insn assembles to bytes again, either
+    // exactly or as one of the candidates of an AMBIGUOUS result
+    bool roundTrips(const Instruction &insn, const uint8_t *bytes) const;
+
+  private:
+    struct Slot {
+        uint32_t hash;
+        uint16_t begin; // into order
+        uint16_t end;
+    };
+
+    // Entries of ops[] grouped by mnemonic, in table order within a group
+    std::vector<uint16_t> order;
+
+    // Open addressing on the hash of the mnemonic, end == 0 is empty
+    std::vector<Slot> slots;
+
+    const Slot *find(const char *name, size_t len, uint32_t hash) const;
+};
@@ -0,0 +1,280 @@
+#include "Batch.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "File.h"
+#include "Output.h"
+#include "Record.h"
+
+std::vector<BatchFile> readManifest(const char *filename,
+                                    uint32_t execOffset) {
+    const FileDescriptorRO rofd(filename);
+    const FileView view(rofd.fd);
+
+    const char *text = (const char *)view.data();
+    const char *end = text + view.size();
+    std::vector<BatchFile> files;
+
+    while (text < end) {
+        const char *eol = std::find(text, end, '\n');
+        std::string line(text, eol);
+        text = eol + (eol < end);
+
+        const size_t first = line.find_first_not_of(" \t\r");
+
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+
+        const size_t nameEnd = line.find_first_of(" \t\r", first);
+        BatchFile file{line.substr(first, nameEnd - first), execOffset};
+
+        const size_t offset = line.find_first_not_of(" \t\r", nameEnd);
+
+        if (offset != std::string::npos) {
+            const size_t offsetEnd = line.find_last_not_of(" \t\r") + 1;
+            const std::string arg = line.substr(offset, offsetEnd - offset);
+            char *endptr;
+            file.execOffset = strtoul(arg.c_str(), &endptr, 16);
+
+            if (*endptr != '\0') {
+                printf("Offset of %s in the manifest is not a hexidecimal "
+                       "number\n",
+                       file.name.c_str());
+                throw -1;
+            }
+        }
+
+        files.push_back(file);
+    }
+
+    return files;
+}
+
+static const char *getExtension(OutputMode mode) {
+    switch (mode) {
+    case OutputMode::TEXT:
+        return ".dasm";
+    case OutputMode::BINARY:
+        return ".bin";
+    case OutputMode::JSON:
+        return ".jsonl";
+    }
+
+    return "";
+}
+
+static std::string getTag(OutputMode mode, const std::string &name,
+                          bool failed) {
+    if (mode != OutputMode::JSON) {
+        return "; file " + name + (failed ? " failed\n" : "\n");
+    }
+
+    std::string tag = "{\"file\":\"";
+
+    for (char c : name) {
+        if (c == '"' || c == '\\') {
+            tag += '\\';
+        }
+
+        tag += c;
+    }
+
+    return tag + (failed ? "\",\"failed\":true}\n" : "\"}\n");
+}
+
+static std::string getOutPath(const BatchFile &file, OutputMode mode,
+                              const char *outDir) {
+    const size_t slash = file.name.rfind('/');
+
+    return std::string(outDir) + "/" +
+           file.name.substr(slash == std::string::npos ? 0 : slash + 1) +
+           getExtension(mode);
+}
+
+// Runs work into its own output file, returns false if it failed
+static bool
+runToFile(const BatchFile &file, OutputMode mode, const std::string &path,
+          const std::function<void(const BatchFile &, Output &)> &work) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (fd == -1) {
+        printf("Cannot open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+
+    try {
+        Output out(fd, true, mode);
+        work(file, out);
+        out.flush();
+    } catch (...) {
+        ok = false;
+    }
+
+    close(fd);
+
+    // Half a listing looks like a complete one
+    if (!ok) {
+        unlink(path.c_str());
+    }
+
+    return ok;
+}
+
+size_t runBatch(const std::vector<BatchFile> &files, size_t threads,
+                OutputMode mode, const char *outDir,
+                const std::function<void(const BatchFile &, Output &)> &work) {
+    threads = std::max<size_t>(threads, 1);
+
+    struct Result {
+        std::vector<char> text;
+        bool ok;
+        bool done;
+    };
+
+    std::vector<Result> results(files.size());
+
+    // Files with the same name in different directories would overwrite
+    // each other, all but the first of them fail
+    std::vector<std::string> paths(files.size());
+
+    if (outDir) {
+        std::map<std::string, size_t> owners;
+
+        for (size_t i = 0; i < files.size(); i++) {
+            const std::string path = getOutPath(files[i], mode, outDir);
+            auto it = owners.emplace(path, i).first;
+
+            if (it->second == i) {
+                paths[i] = path;
+            } else {
+                fprintf(stderr, "%s and %s both write %s\n",
+                        files[it->second].name.c_str(), files[i].name.c_str(),
+                        path.c_str());
+            }
+        }
+    }
+
+    // Diagnostics are printed to stdout, where they would end up inside the
+    // listings. stdout is stderr while the workers run, the listings go to
+    // the real one.
+    fflush(stdout);
+    const int listingFd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    FILE *listing = fdopen(listingFd, "w");
+
+    // Without outDir, workers may only run this far ahead of the writer,
+    // which bounds the amount of text held in memory
+    const size_t window = outDir ? files.size() : threads * 4;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t next = 0;
+    size_t emitted = 0;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t i;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() {
+                    return next >= files.size() || next < emitted + window;
+                });
+
+                if (next >= files.size()) {
+                    return;
+                }
+
+                i = next++;
+            }
+
+            Result &result = results[i];
+
+            if (outDir) {
+                result.ok = !paths[i].empty() &&
+                            runToFile(files[i], mode, paths[i], work);
+            } else {
+                try {
+                    Output out(result.text, mode);
+                    work(files[i], out);
+                    out.flush();
+                    result.ok = true;
+                } catch (...) {
+                    result.ok = false;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result.done = true;
+            }
+
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    size_t failed = 0;
+
+    for (size_t i = 0; i < files.size(); i++) {
+        Result &result = results[i];
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return result.done; });
+        }
+
+        failed += !result.ok;
+
+        // Like with outDir, a failed file leaves nothing but its tag
+        if (!outDir) {
+            const std::string tag = getTag(mode, files[i].name, !result.ok);
+            fwrite(tag.data(), 1, tag.size(), listing);
+
+            if (result.ok) {
+                fwrite(result.text.data(), 1, result.text.size(), listing);
+            }
+
+            std::vector<char>().swap(result.text);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            emitted = i + 1;
+        }
+
+        cond.notify_all();
+    }
+
+    for (std::thread &t : workers) {
+        t.join();
+    }
+
+    fflush(listing);
+    fflush(stdout);
+    dup2(listingFd, STDOUT_FILENO);
+    fclose(listing);
+
+    return failed;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Output.h"
+#include "Record.h"
+
+struct BatchFile {
+    std::string name;
+    uint32_t execOffset;
+};
+
+// One file per line, optionally followed by its load offset (hex), which
+// defaults to execOffset. Empty lines and lines starting with # are skipped.
+std::vector<BatchFile> readManifest(const char *filename,
+                                    uint32_t execOffset);
+
+// Calls work for every file on threads workers. A file that throws is
+// reported as failed, its output is dropped and the others go on. With
+// outDir, file dir/a.COM is written to outDir/a.COM plus .dasm, .bin or
+// .jsonl for the mode, and a second file of that name fails. Without it, the
+// outputs go to stdout in the order of files, each after a tag line:
+// "; file name" or {"file":"name"}, with " failed" or "failed":true added
+// when work threw. What work prints to stdout goes to stderr meanwhile.
+// Returns the number of failed files.
+size_t runBatch(const std::vector<BatchFile> &files, size_t threads,
+                OutputMode mode, const char *outDir,
+                const std::function<void(const BatchFile &, Output &)> &work);
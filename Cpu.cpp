@@ -0,0 +1,1389 @@
+#include "Cpu.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "Decoder.h"
+
+// Decoding may look at up to 3 bytes even when fewer are used, e.g. for DB
+static const size_t minSpan = 3;
+
+static const uint8_t parity[256] = {
+#define P2(n) n, n ^ 1, n ^ 1, n
+#define P4(n) P2(n), P2(n ^ 1), P2(n ^ 1), P2(n)
+#define P6(n) P4(n), P4(n ^ 1), P4(n ^ 1), P4(n)
+    P6(1), P6(0), P6(0), P6(1)
+#undef P6
+#undef P4
+#undef P2
+};
+
+// Opcodes whose 8 bit immediate is sign extended
+static bool signExtends(uint8_t code) {
+    return code == 0x6A || code == 0x6B || code == 0x83 ||
+           (code >= 0x70 && code <= 0x7F) || (code >= 0xE0 && code <= 0xE3) ||
+           code == 0xEB;
+}
+
+void makeUop(const Instruction &insn, const uint8_t *cDecode, Uop &uop) {
+    uop = Uop{};
+    uop.len = insn.len;
+    uop.code = cDecode[0];
+
+    if (insn.hasModRM) {
+        uop.modrm = (uint8_t)((uint8_t)insn.mod << 6 | insn.reg << 3 | insn.rm);
+    }
+
+    uop.disp = insn.dispWidth == Width::BYTE ? (uint16_t)(int8_t)insn.disp
+                                             : insn.disp;
+
+    if (insn.status == Status::FPU_RESERVED) {
+        return;
+    }
+
+    if (insn.status != Status::OP) {
+        uop.flags = uopInvalid | uopEnd;
+        return;
+    }
+
+    const Op &op = *(insn.op);
+
+    if (op.codeSz == 2) {
+        if (op.code[0] == 0x0F) {
+            uop.code = op.code[1];
+            uop.flags |= uopTwoByte;
+        } else if (op.code[0] == 0xF3) {
+            uop.code = op.code[1];
+            uop.flags |= uopRep;
+        } else if (op.code[0] == 0xF2) {
+            uop.code = op.code[1];
+            uop.flags |= uopRepNE;
+        } else {
+            // AAM and AAD with their base
+            uop.imm = op.code[1];
+        }
+    }
+
+    bool first = true;
+
+    for (const Operand &operand : insn.operands) {
+        uint16_t val;
+
+        switch (operand.type) {
+        case Type::DB:
+            val = signExtends(uop.code) ? (uint16_t)(int8_t)operand.val
+                                        : (uint16_t)operand.val;
+            break;
+        case Type::DW:
+        case Type::DEREFBYTEATDW:
+        case Type::DEREFWORDATDW:
+            val = (uint16_t)operand.val;
+            break;
+        case Type::DDW:
+            uop.imm = (uint16_t)operand.val;
+            uop.imm2 = (uint16_t)(operand.val >> 16);
+            first = false;
+            continue;
+        default:
+            continue;
+        }
+
+        if (first) {
+            uop.imm = val;
+            first = false;
+        } else {
+            uop.imm2 = val;
+        }
+    }
+
+    uint32_t target;
+    const Flow flow = getFlow(insn, target);
+
+    if (flow != Flow::NEXT || uop.code == 0xCC || uop.code == 0xCD ||
+        uop.code == 0xCE || uop.code == 0xF4 || (uop.flags & uopTwoByte)) {
+        uop.flags |= uopEnd;
+    }
+}
+
+Cpu::Cpu()
+    : regs(), sregs(), ip(0), flags(0x0002), mem(memSize), steps(0),
+      pageBlocks(memSize >> pageBits), codeBytes(memSize),
+      generation(0), override(-1), rep(0), exited(false), stop(Stop::LIMIT) {}
+
+void Cpu::loadCom(const uint8_t *image, size_t size, uint16_t seg) {
+    const uint32_t base = linear(seg, 0);
+
+    // PSP: INT 20h at offset 0, the rest cleared
+    for (size_t i = 0; i < 0x100; i++) {
+        write8(base + i, 0);
+    }
+
+    write8(base, 0xCD);
+    write8(base + 1, 0x20);
+
+    size = std::min<size_t>(size, 0xFF00);
+
+    for (size_t i = 0; i < size; i++) {
+        write8(base + 0x100 + i, image[i]);
+    }
+
+    std::fill(std::begin(regs), std::end(regs), 0);
+    std::fill(std::begin(sregs), std::end(sregs), seg);
+
+    regs[4] = 0xFFFE;
+    write16(linear(seg, 0xFFFE), 0);
+
+    ip = 0x100;
+    flags = 0x0002 | IF;
+    override = -1;
+    rep = 0;
+}
+
+uint16_t Cpu::read16(uint32_t linear) const {
+    return (uint16_t)(read8(linear) | read8(linear + 1) << 8);
+}
+
+void Cpu::write8(uint32_t linear, uint8_t val) {
+    const uint32_t addr = linear & memMask;
+
+    // Rewriting the same value keeps the decoded blocks valid
+    if (mem[addr] == val) {
+        return;
+    }
+
+    mem[addr] = val;
+
+    if (codeBytes[addr]) {
+        invalidatePage(addr >> pageBits);
+    }
+}
+
+void Cpu::write16(uint32_t linear, uint16_t val) {
+    write8(linear, (uint8_t)val);
+    write8(linear + 1, (uint8_t)(val >> 8));
+}
+
+void Cpu::invalidatePage(size_t page) {
+    // Blocks spanning two pages leave the list of the other one as well.
+    // Their bytes in the other page stay marked, which only costs a spurious
+    // invalidation later.
+    for (uint32_t key : pageBlocks[page]) {
+        const auto it = blocks.find(key);
+
+        for (size_t other : it->second.pages) {
+            if (other != page) {
+                std::vector<uint32_t> &keys = pageBlocks[other];
+                keys.erase(std::remove(keys.begin(), keys.end(), key),
+                           keys.end());
+            }
+        }
+
+        blocks.erase(it);
+    }
+
+    pageBlocks[page].clear();
+
+    const size_t first = page << pageBits;
+    std::fill(codeBytes.begin() + first,
+              codeBytes.begin() + first + (1 << pageBits), false);
+    generation++;
+}
+
+void Cpu::decodeAt(uint16_t seg, uint16_t off, Instruction &insn,
+                   uint8_t *bytes) const {
+    // The offset wraps around within the segment
+    for (size_t i = 0; i < maxOPLen; i++) {
+        bytes[i] = read8(linear(seg, (uint16_t)(off + i)));
+    }
+
+    decodeOP(bytes, maxOPLen, linear(seg, off), insn);
+}
+
+const Cpu::Block &Cpu::getBlock() {
+    const uint32_t key = (uint32_t)sregs[CS] << 16 | ip;
+
+    auto it = blocks.find(key);
+
+    if (it != blocks.end()) {
+        return it->second;
+    }
+
+    Block block;
+    std::vector<size_t> &pages = block.pages;
+    uint16_t off = ip;
+
+    while (block.uops.size() < maxBlockLen) {
+        Instruction insn;
+        uint8_t bytes[maxOPLen];
+        decodeAt(sregs[CS], off, insn, bytes);
+
+        Uop uop;
+        makeUop(insn, bytes, uop);
+        block.uops.push_back(uop);
+
+        for (size_t i = 0; i < std::max<size_t>(uop.len, minSpan); i++) {
+            const uint32_t addr =
+                linear(sregs[CS], (uint16_t)(off + i)) & memMask;
+            const size_t page = addr >> pageBits;
+            codeBytes[addr] = true;
+
+            if (std::find(pages.begin(), pages.end(), page) == pages.end()) {
+                pages.push_back(page);
+            }
+        }
+
+        const uint16_t next = (uint16_t)(off + uop.len);
+
+        if ((uop.flags & uopEnd) || next < off) {
+            break;
+        }
+
+        off = next;
+    }
+
+    for (size_t page : pages) {
+        pageBlocks[page].push_back(key);
+    }
+
+    return blocks.emplace(key, std::move(block)).first->second;
+}
+
+Stop Cpu::run(uint64_t maxSteps, bool useBlocks) {
+    const uint64_t end = steps + std::min(maxSteps, UINT64_MAX - steps);
+    exited = false;
+
+    while (steps < end) {
+        if (!useBlocks) {
+            Instruction insn;
+            uint8_t bytes[maxOPLen];
+            decodeAt(sregs[CS], ip, insn, bytes);
+
+            Uop uop;
+            makeUop(insn, bytes, uop);
+
+            ip += uop.len;
+            steps++;
+
+            if (!execute(uop)) {
+                return stop;
+            }
+
+            if (exited) {
+                return Stop::EXIT;
+            }
+
+            continue;
+        }
+
+        const uint64_t gen = generation;
+        const Block &block = getBlock();
+        const size_t count = block.uops.size();
+
+        for (size_t i = 0; i < count && steps < end; i++) {
+            // A write may have dropped this very block
+            if (generation != gen) {
+                break;
+            }
+
+            // A copy, as executing it may drop the block
+            const Uop uop = block.uops[i];
+            const uint16_t cs = sregs[CS];
+            const uint16_t next = ip + uop.len;
+
+            ip = next;
+            steps++;
+
+            if (!execute(uop)) {
+                return stop;
+            }
+
+            if (exited) {
+                return Stop::EXIT;
+            }
+
+            // Taken jumps and interrupts leave the block
+            if (ip != next || sregs[CS] != cs) {
+                break;
+            }
+        }
+    }
+
+    return Stop::LIMIT;
+}
+
+uint16_t Cpu::effectiveOffset(const Uop &uop, int &seg) const {
+    const uint8_t mod = uop.modrm >> 6;
+    const uint8_t rm = uop.modrm & 0b111;
+
+    uint16_t off = 0;
+    seg = DS;
+
+    if (mod == 0 && rm == 0b110) {
+        seg = override >= 0 ? override : DS;
+        return uop.disp;
+    }
+
+    switch (rm) {
+    case 0:
+        off = regs[3] + regs[6];
+        break;
+    case 1:
+        off = regs[3] + regs[7];
+        break;
+    case 2:
+        off = regs[5] + regs[6];
+        seg = SS;
+        break;
+    case 3:
+        off = regs[5] + regs[7];
+        seg = SS;
+        break;
+    case 4:
+        off = regs[6];
+        break;
+    case 5:
+        off = regs[7];
+        break;
+    case 6:
+        off = regs[5];
+        seg = SS;
+        break;
+    case 7:
+        off = regs[3];
+        break;
+    }
+
+    if (override >= 0) {
+        seg = override;
+    }
+
+    return (uint16_t)(off + uop.disp);
+}
+
+uint32_t Cpu::effectiveAddress(const Uop &uop) const {
+    int seg;
+    const uint16_t off = effectiveOffset(uop, seg);
+    return linear(sregs[seg], off);
+}
+
+uint8_t Cpu::getReg8(size_t r) const {
+    return r < 4 ? (uint8_t)regs[r] : (uint8_t)(regs[r - 4] >> 8);
+}
+
+void Cpu::setReg8(size_t r, uint8_t val) {
+    if (r < 4) {
+        regs[r] = (regs[r] & 0xFF00) | val;
+    } else {
+        regs[r - 4] = (uint16_t)((regs[r - 4] & 0x00FF) | val << 8);
+    }
+}
+
+uint8_t Cpu::getRM8(const Uop &uop) {
+    if (uop.modrm >> 6 == 3) {
+        return getReg8(uop.modrm & 0b111);
+    }
+
+    return read8(effectiveAddress(uop));
+}
+
+uint16_t Cpu::getRM16(const Uop &uop) {
+    if (uop.modrm >> 6 == 3) {
+        return regs[uop.modrm & 0b111];
+    }
+
+    return read16(effectiveAddress(uop));
+}
+
+void Cpu::setRM8(const Uop &uop, uint8_t val) {
+    if (uop.modrm >> 6 == 3) {
+        setReg8(uop.modrm & 0b111, val);
+    } else {
+        write8(effectiveAddress(uop), val);
+    }
+}
+
+void Cpu::setRM16(const Uop &uop, uint16_t val) {
+    if (uop.modrm >> 6 == 3) {
+        regs[uop.modrm & 0b111] = val;
+    } else {
+        write16(effectiveAddress(uop), val);
+    }
+}
+
+void Cpu::push(uint16_t val) {
+    regs[4] -= 2;
+    write16(linear(sregs[SS], regs[4]), val);
+}
+
+uint16_t Cpu::pop() {
+    const uint16_t val = read16(linear(sregs[SS], regs[4]));
+    regs[4] += 2;
+    return val;
+}
+
+void Cpu::setSZP(uint16_t res, bool w) {
+    const uint16_t sign = w ? 0x8000 : 0x80;
+    const uint16_t mask = w ? 0xFFFF : 0xFF;
+
+    flags &= ~(SF | ZF | PF);
+    flags |= (res & sign) ? SF : 0;
+    flags |= (res & mask) == 0 ? ZF : 0;
+    flags |= parity[res & 0xFF] ? PF : 0;
+}
+
+// op as in the ALU opcodes: ADD OR ADC SBB AND SUB XOR CMP
+uint16_t Cpu::alu(size_t op, uint16_t a, uint16_t b, bool w) {
+    const uint32_t mask = w ? 0xFFFF : 0xFF;
+    const uint32_t sign = w ? 0x8000 : 0x80;
+    uint32_t res;
+
+    switch (op) {
+    case 0:
+    case 2: {
+        const uint32_t carry = op == 2 && (flags & CF) ? 1 : 0;
+        res = (uint32_t)a + b + carry;
+
+        flags &= ~(CF | OF | AF);
+        flags |= res > mask ? CF : 0;
+        flags |= ((a ^ res) & (b ^ res) & sign) ? OF : 0;
+        flags |= ((a ^ b ^ res) & 0x10) ? AF : 0;
+        break;
+    }
+    case 3:
+    case 5:
+    case 7: {
+        const uint32_t borrow = op == 3 && (flags & CF) ? 1 : 0;
+        res = (uint32_t)a - b - borrow;
+
+        flags &= ~(CF | OF | AF);
+        flags |= (uint32_t)a < (uint32_t)b + borrow ? CF : 0;
+        flags |= ((a ^ b) & (a ^ res) & sign) ? OF : 0;
+        flags |= ((a ^ b ^ res) & 0x10) ? AF : 0;
+        break;
+    }
+    default:
+        res = op == 1 ? a | b : op == 4 ? a & b : a ^ b;
+        flags &= ~(CF | OF | AF);
+        break;
+    }
+
+    res &= mask;
+    setSZP((uint16_t)res, w);
+
+    return (uint16_t)res;
+}
+
+// op as in the shift group: ROL ROR RCL RCR SHL SHR SAL SAR
+uint16_t Cpu::shift(size_t op, uint16_t a, uint8_t count, bool w) {
+    const size_t bits = w ? 16 : 8;
+    const uint32_t mask = w ? 0xFFFF : 0xFF;
+    const uint32_t sign = w ? 0x8000 : 0x80;
+
+    // The 286 masks the count to 5 bits
+    count &= 0x1F;
+
+    if (count == 0) {
+        return a;
+    }
+
+    uint32_t res = a;
+    bool cf = flags & CF;
+
+    switch (op) {
+    case 0:
+        for (size_t i = 0; i < count; i++) {
+            cf = res & sign;
+            res = ((res << 1) | cf) & mask;
+        }
+        break;
+    case 1:
+        for (size_t i = 0; i < count; i++) {
+            cf = res & 1;
+            res = (res >> 1) | (cf ? sign : 0);
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < count; i++) {
+            const bool out = res & sign;
+            res = ((res << 1) | cf) & mask;
+            cf = out;
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < count; i++) {
+            const bool out = res & 1;
+            res = (res >> 1) | (cf ? sign : 0);
+            cf = out;
+        }
+        break;
+    case 4:
+    case 6:
+        cf = count <= bits && ((res << (count - 1)) & sign);
+        res = (res << count) & mask;
+        break;
+    case 5:
+        cf = count <= bits && ((res >> (count - 1)) & 1);
+        res = count < bits ? res >> count : 0;
+        break;
+    case 7: {
+        const int32_t sa = w ? (int16_t)a : (int8_t)a;
+        const size_t n = std::min<size_t>(count, bits);
+
+        cf = (sa >> (n - 1)) & 1;
+        res = (uint32_t)(sa >> n) & mask;
+        break;
+    }
+    }
+
+    flags &= ~(CF | OF);
+    flags |= cf ? CF : 0;
+
+    // OF as defined for a count of 1
+    const bool top = res & sign;
+    const bool second = res & (sign >> 1);
+
+    switch (op) {
+    case 1:
+    case 3:
+        flags |= top != second ? OF : 0;
+        break;
+    case 5:
+        flags |= (a & sign) ? OF : 0;
+        break;
+    case 7:
+        break;
+    default:
+        flags |= top != cf ? OF : 0;
+        break;
+    }
+
+    if (op >= 4) {
+        setSZP((uint16_t)res, w);
+    }
+
+    return (uint16_t)res;
+}
+
+bool Cpu::condition(uint8_t cc) const {
+    const bool cf = flags & CF;
+    const bool zf = flags & ZF;
+    const bool sf = flags & SF;
+    const bool of = flags & OF;
+    bool res;
+
+    switch (cc >> 1) {
+    case 0:
+        res = of;
+        break;
+    case 1:
+        res = cf;
+        break;
+    case 2:
+        res = zf;
+        break;
+    case 3:
+        res = cf || zf;
+        break;
+    case 4:
+        res = sf;
+        break;
+    case 5:
+        res = flags & PF;
+        break;
+    case 6:
+        res = sf != of;
+        break;
+    default:
+        res = zf || sf != of;
+        break;
+    }
+
+    return (cc & 1) ? !res : res;
+}
+
+bool Cpu::interrupt(uint8_t vector) {
+    if (onInterrupt && onInterrupt(*this, vector)) {
+        return true;
+    }
+
+    push(flags);
+    push(sregs[CS]);
+    push(ip);
+
+    flags &= ~(IF | TF);
+    ip = read16(vector * 4);
+    sregs[CS] = read16(vector * 4 + 2);
+
+    return true;
+}
+
+bool Cpu::stringOp(const Uop &uop) {
+    const uint8_t code = uop.code;
+    const bool w = code & 1;
+    const uint16_t size = w ? 2 : 1;
+    const uint16_t delta = (flags & DF) ? (uint16_t)-size : size;
+    const int src = override >= 0 ? override : DS;
+
+    uint8_t repMode = rep;
+
+    if (uop.flags & uopRep) {
+        repMode = 1;
+    } else if (uop.flags & uopRepNE) {
+        repMode = 2;
+    }
+
+    const bool compares = (code & 0xF6) == 0xA6;
+
+    while (!repMode || regs[1] != 0) {
+        const uint32_t si = linear(sregs[src], regs[6]);
+        const uint32_t di = linear(sregs[ES], regs[7]);
+
+        switch (code & 0xFE) {
+        case 0xA4:
+            if (w) {
+                write16(di, read16(si));
+            } else {
+                write8(di, read8(si));
+            }
+            regs[6] += delta;
+            regs[7] += delta;
+            break;
+        case 0xA6:
+            if (w) {
+                alu(7, read16(si), read16(di), true);
+            } else {
+                alu(7, read8(si), read8(di), false);
+            }
+            regs[6] += delta;
+            regs[7] += delta;
+            break;
+        case 0xAA:
+            if (w) {
+                write16(di, regs[0]);
+            } else {
+                write8(di, (uint8_t)regs[0]);
+            }
+            regs[7] += delta;
+            break;
+        case 0xAC:
+            if (w) {
+                regs[0] = read16(si);
+            } else {
+                setReg8(0, read8(si));
+            }
+            regs[6] += delta;
+            break;
+        case 0xAE:
+            if (w) {
+                alu(7, regs[0], read16(di), true);
+            } else {
+                alu(7, (uint8_t)regs[0], read8(di), false);
+            }
+            regs[7] += delta;
+            break;
+        case 0x6C:
+            // No devices, ports read as all ones
+            if (w) {
+                write16(di, 0xFFFF);
+            } else {
+                write8(di, 0xFF);
+            }
+            regs[7] += delta;
+            break;
+        case 0x6E:
+            regs[6] += delta;
+            break;
+        }
+
+        if (!repMode) {
+            break;
+        }
+
+        regs[1]--;
+
+        if (compares && ((repMode == 1) != ((flags & ZF) != 0))) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool Cpu::group3(const Uop &uop, bool w) {
+    const size_t op = (uop.modrm >> 3) & 0b111;
+    const uint16_t src = w ? getRM16(uop) : getRM8(uop);
+
+    switch (op) {
+    case 0:
+    case 1:
+        alu(4, src, uop.imm, w);
+        return true;
+    case 2:
+        if (w) {
+            setRM16(uop, ~src);
+        } else {
+            setRM8(uop, (uint8_t)~src);
+        }
+        return true;
+    case 3: {
+        const uint16_t res = alu(5, 0, src, w);
+
+        if (w) {
+            setRM16(uop, res);
+        } else {
+            setRM8(uop, (uint8_t)res);
+        }
+        return true;
+    }
+    case 4:
+    case 5: {
+        bool high;
+
+        if (w) {
+            const uint32_t res =
+                op == 4 ? (uint32_t)regs[0] * src
+                        : (uint32_t)((int32_t)(int16_t)regs[0] * (int16_t)src);
+
+            regs[0] = (uint16_t)res;
+            regs[2] = (uint16_t)(res >> 16);
+            high = op == 4 ? regs[2] != 0
+                           : (int32_t)res != (int16_t)regs[0];
+        } else {
+            const uint16_t res =
+                op == 4 ? (uint16_t)((uint8_t)regs[0] * src)
+                        : (uint16_t)((int8_t)regs[0] * (int8_t)src);
+
+            regs[0] = res;
+            high = op == 4 ? (res >> 8) != 0 : (int16_t)res != (int8_t)res;
+        }
+
+        flags &= ~(CF | OF);
+        flags |= high ? (CF | OF) : 0;
+        return true;
+    }
+    default:
+        break;
+    }
+
+    // DIV and IDIV, errors point at the instruction
+    bool error = src == 0;
+
+    if (!error && w) {
+        const uint32_t num = (uint32_t)regs[2] << 16 | regs[0];
+
+        if (op == 6) {
+            const uint32_t q = num / src;
+            error = q > 0xFFFF;
+
+            if (!error) {
+                regs[0] = (uint16_t)q;
+                regs[2] = (uint16_t)(num % src);
+            }
+        } else {
+            // 0x80000000 / -1 does not fit 32 bits either
+            const int64_t q = (int64_t)(int32_t)num / (int16_t)src;
+            error = q < -32768 || q > 32767;
+
+            if (!error) {
+                regs[0] = (uint16_t)q;
+                regs[2] = (uint16_t)((int64_t)(int32_t)num % (int16_t)src);
+            }
+        }
+    } else if (!error) {
+        if (op == 6) {
+            const uint16_t q = regs[0] / src;
+            error = q > 0xFF;
+
+            if (!error) {
+                regs[0] = (uint16_t)((regs[0] % src) << 8 | q);
+            }
+        } else {
+            const int16_t num = (int16_t)regs[0];
+            const int16_t q = num / (int8_t)src;
+            error = q < -128 || q > 127;
+
+            if (!error) {
+                const int8_t r = (int8_t)(num % (int8_t)src);
+                regs[0] = (uint16_t)((uint8_t)r << 8 | (uint8_t)q);
+            }
+        }
+    }
+
+    if (error) {
+        ip -= uop.len;
+        return interrupt(0);
+    }
+
+    return true;
+}
+
+bool Cpu::execute(const Uop &uop) {
+    const uint8_t code = uop.code;
+
+    if (uop.flags & uopInvalid) {
+        // Prefixes the decoder does not know on their own
+        if (code == 0x26 || code == 0x2E || code == 0x36 || code == 0x3E) {
+            override = (code >> 3) & 0b11;
+            return true;
+        }
+
+        if (code == 0xF2 || code == 0xF3) {
+            rep = code == 0xF3 ? 1 : 2;
+            return true;
+        }
+    }
+
+    bool ok = true;
+    const bool w = code & 1;
+    const size_t reg = (uop.modrm >> 3) & 0b111;
+
+    if (uop.flags & (uopInvalid | uopTwoByte)) {
+        // Protected mode and system instructions are not emulated
+        ok = false;
+    } else if (code < 0x40 && (code & 0b111) < 6) {
+        // ALU ops in their six forms
+        const size_t op = code >> 3;
+        uint16_t res;
+
+        switch (code & 0b111) {
+        case 0:
+            res = alu(op, getRM8(uop), getReg8(reg), false);
+            if (op != 7) {
+                setRM8(uop, (uint8_t)res);
+            }
+            break;
+        case 1:
+            res = alu(op, getRM16(uop), regs[reg], true);
+            if (op != 7) {
+                setRM16(uop, res);
+            }
+            break;
+        case 2:
+            res = alu(op, getReg8(reg), getRM8(uop), false);
+            if (op != 7) {
+                setReg8(reg, (uint8_t)res);
+            }
+            break;
+        case 3:
+            res = alu(op, regs[reg], getRM16(uop), true);
+            if (op != 7) {
+                regs[reg] = res;
+            }
+            break;
+        case 4:
+            res = alu(op, (uint8_t)regs[0], uop.imm, false);
+            if (op != 7) {
+                setReg8(0, (uint8_t)res);
+            }
+            break;
+        default:
+            res = alu(op, regs[0], uop.imm, true);
+            if (op != 7) {
+                regs[0] = res;
+            }
+            break;
+        }
+    } else if (code < 0x40 && (code & 0b111) == 6) {
+        push(sregs[(code >> 3) & 0b11]);
+    } else if (code < 0x20 && (code & 0b111) == 7) {
+        // POP CS is 0x0F, which never gets here
+        sregs[(code >> 3) & 0b11] = pop();
+    } else if (code < 0x40) {
+        // DAA DAS AAA AAS
+        const uint8_t al = (uint8_t)regs[0];
+        const bool cf = flags & CF;
+        const bool af = flags & AF;
+
+        switch (code) {
+        case 0x27:
+        case 0x2F: {
+            uint8_t res = al;
+            bool newCF = false;
+            bool newAF = false;
+
+            if ((al & 0x0F) > 9 || af) {
+                res = code == 0x27 ? res + 6 : res - 6;
+                newAF = true;
+            }
+
+            if (al > 0x99 || cf) {
+                res = code == 0x27 ? res + 0x60 : res - 0x60;
+                newCF = true;
+            }
+
+            setReg8(0, res);
+            setSZP(res, false);
+            flags &= ~(CF | AF);
+            flags |= (newCF ? CF : 0) | (newAF ? AF : 0);
+            break;
+        }
+        default:
+            flags &= ~(CF | AF);
+
+            if ((al & 0x0F) > 9 || af) {
+                const int d = code == 0x37 ? 1 : -1;
+                regs[0] = (uint16_t)(regs[0] + d * 0x106);
+                flags |= CF | AF;
+            }
+
+            regs[0] &= 0xFF0F;
+            break;
+        }
+    } else if (code < 0x50) {
+        // INC and DEC keep CF
+        const uint16_t cf = flags & CF;
+        regs[code & 0b111] =
+            alu(code < 0x48 ? 0 : 5, regs[code & 0b111], 1, true);
+        flags = (flags & ~CF) | cf;
+    } else if (code < 0x58) {
+        // PUSH SP pushes the value before the push on the 286
+        push(regs[code & 0b111]);
+    } else if (code < 0x60) {
+        regs[code & 0b111] = pop();
+    } else if (code >= 0x70 && code < 0x80) {
+        if (condition(code & 0x0F)) {
+            ip += uop.imm;
+        }
+    } else if (code >= 0x90 && code < 0x98) {
+        std::swap(regs[0], regs[code & 0b111]);
+    } else if (code >= 0xB0 && code < 0xB8) {
+        setReg8(code & 0b111, (uint8_t)uop.imm);
+    } else if (code >= 0xB8 && code < 0xC0) {
+        regs[code & 0b111] = uop.imm;
+    } else if ((code & 0xF0) == 0xA0 && code >= 0xA4 &&
+               !(code == 0xA8 || code == 0xA9)) {
+        ok = stringOp(uop);
+    } else if (code >= 0x6C && code <= 0x6F) {
+        ok = stringOp(uop);
+    } else if (code >= 0xD8 && code <= 0xDF) {
+        // No FPU, ESC does nothing
+    } else {
+        switch (code) {
+        case 0x60: {
+            const uint16_t sp = regs[4];
+
+            for (size_t r = 0; r < 8; r++) {
+                push(r == 4 ? sp : regs[r]);
+            }
+            break;
+        }
+        case 0x61:
+            for (size_t r = 8; r-- > 0;) {
+                const uint16_t val = pop();
+
+                if (r != 4) {
+                    regs[r] = val;
+                }
+            }
+            break;
+        case 0x62: {
+            if (uop.modrm >> 6 == 3) {
+                ok = false;
+                break;
+            }
+
+            const uint32_t ea = effectiveAddress(uop);
+            const int16_t val = (int16_t)regs[reg];
+
+            if (val < (int16_t)read16(ea) || val > (int16_t)read16(ea + 2)) {
+                ip -= uop.len;
+                interrupt(5);
+            }
+            break;
+        }
+        case 0x68:
+        case 0x6A:
+            push(uop.imm);
+            break;
+        case 0x69:
+        case 0x6B: {
+            const int32_t res = (int16_t)getRM16(uop) * (int16_t)uop.imm;
+
+            regs[reg] = (uint16_t)res;
+            flags &= ~(CF | OF);
+            flags |= res != (int16_t)res ? (CF | OF) : 0;
+            break;
+        }
+        case 0x80:
+        case 0x82:
+            if (reg == 7) {
+                alu(reg, getRM8(uop), uop.imm, false);
+            } else {
+                setRM8(uop, (uint8_t)alu(reg, getRM8(uop), uop.imm, false));
+            }
+            break;
+        case 0x81:
+        case 0x83:
+            if (reg == 7) {
+                alu(reg, getRM16(uop), uop.imm, true);
+            } else {
+                setRM16(uop, alu(reg, getRM16(uop), uop.imm, true));
+            }
+            break;
+        case 0x84:
+            alu(4, getRM8(uop), getReg8(reg), false);
+            break;
+        case 0x85:
+            alu(4, getRM16(uop), regs[reg], true);
+            break;
+        case 0x86: {
+            const uint8_t val = getRM8(uop);
+            setRM8(uop, getReg8(reg));
+            setReg8(reg, val);
+            break;
+        }
+        case 0x87: {
+            const uint16_t val = getRM16(uop);
+            setRM16(uop, regs[reg]);
+            regs[reg] = val;
+            break;
+        }
+        case 0x88:
+            setRM8(uop, getReg8(reg));
+            break;
+        case 0x89:
+            setRM16(uop, regs[reg]);
+            break;
+        case 0x8A:
+            setReg8(reg, getRM8(uop));
+            break;
+        case 0x8B:
+            regs[reg] = getRM16(uop);
+            break;
+        case 0x8C:
+            setRM16(uop, sregs[reg & 0b11]);
+            break;
+        case 0x8D: {
+            int seg;
+            ok = uop.modrm >> 6 != 3;
+            regs[reg] = effectiveOffset(uop, seg);
+            break;
+        }
+        case 0x8E:
+            ok = (reg & 0b11) != CS;
+            if (ok) {
+                sregs[reg & 0b11] = getRM16(uop);
+            }
+            break;
+        case 0x8F: {
+            const uint16_t val = pop();
+            setRM16(uop, val);
+            break;
+        }
+        case 0x98:
+            regs[0] = (uint16_t)(int8_t)regs[0];
+            break;
+        case 0x99:
+            regs[2] = (regs[0] & 0x8000) ? 0xFFFF : 0;
+            break;
+        case 0x9A:
+            push(sregs[CS]);
+            push(ip);
+            sregs[CS] = uop.imm2;
+            ip = uop.imm;
+            break;
+        case 0x9B:
+            break;
+        case 0x9C:
+            push(flags & 0x0FFF);
+            break;
+        case 0x9D:
+            flags = (pop() & 0x0FD5) | 0x0002;
+            break;
+        case 0x9E:
+            flags = (flags & 0xFF00) | ((regs[0] >> 8) & 0xD5) | 0x0002;
+            break;
+        case 0x9F:
+            setReg8(4, (uint8_t)flags);
+            break;
+        case 0xA0:
+        case 0xA1:
+        case 0xA2:
+        case 0xA3: {
+            const uint32_t addr =
+                linear(sregs[override >= 0 ? override : DS], uop.imm);
+
+            if (code == 0xA0) {
+                setReg8(0, read8(addr));
+            } else if (code == 0xA1) {
+                regs[0] = read16(addr);
+            } else if (code == 0xA2) {
+                write8(addr, (uint8_t)regs[0]);
+            } else {
+                write16(addr, regs[0]);
+            }
+            break;
+        }
+        case 0xA8:
+            alu(4, (uint8_t)regs[0], uop.imm, false);
+            break;
+        case 0xA9:
+            alu(4, regs[0], uop.imm, true);
+            break;
+        case 0xC0:
+            setRM8(uop, (uint8_t)shift(reg, getRM8(uop), (uint8_t)uop.imm,
+                                       false));
+            break;
+        case 0xC1:
+            setRM16(uop, shift(reg, getRM16(uop), (uint8_t)uop.imm, true));
+            break;
+        case 0xC2:
+            ip = pop();
+            regs[4] += uop.imm;
+            break;
+        case 0xC3:
+            ip = pop();
+            break;
+        case 0xC4:
+        case 0xC5: {
+            if (uop.modrm >> 6 == 3) {
+                ok = false;
+                break;
+            }
+
+            const uint32_t ea = effectiveAddress(uop);
+            regs[reg] = read16(ea);
+            sregs[code == 0xC4 ? ES : DS] = read16(ea + 2);
+            break;
+        }
+        case 0xC6:
+            setRM8(uop, (uint8_t)uop.imm);
+            break;
+        case 0xC7:
+            setRM16(uop, uop.imm);
+            break;
+        case 0xC8: {
+            const uint8_t level = uop.imm2 & 0x1F;
+
+            push(regs[5]);
+            const uint16_t frame = regs[4];
+
+            for (size_t i = 1; i < level; i++) {
+                regs[5] -= 2;
+                push(read16(linear(sregs[SS], regs[5])));
+            }
+
+            if (level > 0) {
+                push(frame);
+            }
+
+            regs[5] = frame;
+            regs[4] -= uop.imm;
+            break;
+        }
+        case 0xC9:
+            regs[4] = regs[5];
+            regs[5] = pop();
+            break;
+        case 0xCA:
+        case 0xCB:
+            ip = pop();
+            sregs[CS] = pop();
+            if (code == 0xCA) {
+                regs[4] += uop.imm;
+            }
+            break;
+        case 0xCC:
+            interrupt(3);
+            break;
+        case 0xCD:
+            interrupt((uint8_t)uop.imm);
+            break;
+        case 0xCE:
+            if (flags & OF) {
+                interrupt(4);
+            }
+            break;
+        case 0xCF:
+            ip = pop();
+            sregs[CS] = pop();
+            flags = (pop() & 0x0FD5) | 0x0002;
+            break;
+        case 0xD0:
+            setRM8(uop, (uint8_t)shift(reg, getRM8(uop), 1, false));
+            break;
+        case 0xD1:
+            setRM16(uop, shift(reg, getRM16(uop), 1, true));
+            break;
+        case 0xD2:
+            setRM8(uop,
+                   (uint8_t)shift(reg, getRM8(uop), (uint8_t)regs[1], false));
+            break;
+        case 0xD3:
+            setRM16(uop, shift(reg, getRM16(uop), (uint8_t)regs[1], true));
+            break;
+        case 0xD4: {
+            const uint8_t base = (uint8_t)uop.imm;
+
+            if (base == 0) {
+                ip -= uop.len;
+                interrupt(0);
+                break;
+            }
+
+            const uint8_t al = (uint8_t)regs[0];
+            regs[0] = (uint16_t)((al / base) << 8 | (al % base));
+            setSZP(regs[0], false);
+            break;
+        }
+        case 0xD5: {
+            const uint8_t al =
+                (uint8_t)(getReg8(4) * (uint8_t)uop.imm + (uint8_t)regs[0]);
+            regs[0] = al;
+            setSZP(al, false);
+            break;
+        }
+        case 0xD7: {
+            const int seg = override >= 0 ? override : DS;
+            setReg8(0, read8(linear(sregs[seg],
+                                    (uint16_t)(regs[3] + (uint8_t)regs[0]))));
+            break;
+        }
+        case 0xE0:
+        case 0xE1:
+        case 0xE2: {
+            regs[1]--;
+
+            const bool zf = flags & ZF;
+            const bool taken = regs[1] != 0 && (code == 0xE2 ||
+                                                (code == 0xE1) == zf);
+
+            if (taken) {
+                ip += uop.imm;
+            }
+            break;
+        }
+        case 0xE3:
+            if (regs[1] == 0) {
+                ip += uop.imm;
+            }
+            break;
+        case 0xE4:
+        case 0xEC:
+            setReg8(0, 0xFF);
+            break;
+        case 0xE5:
+        case 0xED:
+            regs[0] = 0xFFFF;
+            break;
+        case 0xE6:
+        case 0xE7:
+        case 0xEE:
+        case 0xEF:
+            break;
+        case 0xE8:
+            push(ip);
+            ip += uop.imm;
+            break;
+        case 0xE9:
+        case 0xEB:
+            ip += uop.imm;
+            break;
+        case 0xEA:
+            sregs[CS] = uop.imm2;
+            ip = uop.imm;
+            break;
+        case 0xF0:
+            break;
+        case 0xF4:
+            stop = Stop::HALT;
+            ip -= uop.len;
+            ok = false;
+            return ok;
+        case 0xF5:
+            flags ^= CF;
+            break;
+        case 0xF6:
+        case 0xF7:
+            ok = group3(uop, w);
+            break;
+        case 0xF8:
+        case 0xF9:
+            flags = (flags & ~CF) | (code & 1 ? CF : 0);
+            break;
+        case 0xFA:
+        case 0xFB:
+            flags = (flags & ~IF) | (code & 1 ? IF : 0);
+            break;
+        case 0xFC:
+        case 0xFD:
+            flags = (flags & ~DF) | (code & 1 ? DF : 0);
+            break;
+        case 0xFE: {
+            ok = reg < 2;
+
+            if (ok) {
+                const uint16_t cf = flags & CF;
+                setRM8(uop,
+                       (uint8_t)alu(reg == 0 ? 0 : 5, getRM8(uop), 1, false));
+                flags = (flags & ~CF) | cf;
+            }
+            break;
+        }
+        case 0xFF:
+            switch (reg) {
+            case 0:
+            case 1: {
+                const uint16_t cf = flags & CF;
+                setRM16(uop, alu(reg == 0 ? 0 : 5, getRM16(uop), 1, true));
+                flags = (flags & ~CF) | cf;
+                break;
+            }
+            case 2: {
+                const uint16_t target = getRM16(uop);
+                push(ip);
+                ip = target;
+                break;
+            }
+            case 4:
+                ip = getRM16(uop);
+                break;
+            case 3:
+            case 5: {
+                if (uop.modrm >> 6 == 3) {
+                    ok = false;
+                    break;
+                }
+
+                const uint32_t ea = effectiveAddress(uop);
+                const uint16_t off = read16(ea);
+                const uint16_t seg = read16(ea + 2);
+
+                if (reg == 3) {
+                    push(sregs[CS]);
+                    push(ip);
+                }
+
+                sregs[CS] = seg;
+                ip = off;
+                break;
+            }
+            case 6:
+                push(getRM16(uop));
+                break;
+            default:
+                ok = false;
+                break;
+            }
+            break;
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    override = -1;
+    rep = 0;
+
+    if (!ok) {
+        stop = Stop::INVALID;
+        ip -= uop.len;
+    }
+
+    return ok;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Decoder.h"
+
+// Compact form of a decoded instruction, all the interpreter needs
+struct Uop {
+    uint8_t code;  // first opcode byte, the second one for 0x0F xx
+    uint8_t flags; // uopRep, uopRepNE, uopTwoByte
+    uint8_t len;
+    uint8_t modrm;
+    uint16_t disp; // sign extended
+    uint16_t imm;  // first immediate, sign extended where the op does
+    uint16_t imm2; // second immediate: segment of far pointers, ENTER level
+};
+
+static const uint8_t uopRep = 1;     // F3 prefix, part of the op
+static const uint8_t uopRepNE = 2;   // F2 prefix, part of the op
+static const uint8_t uopTwoByte = 4; // 0x0F xx
+static const uint8_t uopInvalid = 8; // no op matched, code is the byte
+static const uint8_t uopEnd = 16;    // changes CS:IP or stops, ends a block
+
+// Fills uop from insn, decoded from cDecode
+void makeUop(const Instruction &insn, const uint8_t *cDecode, Uop &uop);
+
+enum class Stop : uint8_t {
+    LIMIT,   // ran the number of steps asked for
+    HALT,    // HLT
+    INVALID, // no op, or one real mode does not run; IP points at it
+    EXIT     // an interrupt hook called exit()
+};
+
+// Real mode 286 without protected mode instructions and without FPU. Memory
+// is 1 MiB and wraps around like with A20 disabled. Instructions are
+// predecoded into blocks of Uops which are cached by CS:IP; a write that
+// changes a byte of cached code drops the blocks of its page.
+class Cpu {
+  public:
+    enum { ES, CS, SS, DS };
+
+    static const uint16_t CF = 0x0001;
+    static const uint16_t PF = 0x0004;
+    static const uint16_t AF = 0x0010;
+    static const uint16_t ZF = 0x0040;
+    static const uint16_t SF = 0x0080;
+    static const uint16_t TF = 0x0100;
+    static const uint16_t IF = 0x0200;
+    static const uint16_t DF = 0x0400;
+    static const uint16_t OF = 0x0800;
+
+    static const size_t memSize = 1 << 20;
+    static const size_t pageBits = 10;
+
+    // Register file indexed like ModRM: AX CX DX BX SP BP SI DI
+    uint16_t regs[8];
+    uint16_t sregs[4];
+    uint16_t ip;
+    uint16_t flags;
+
+    std::vector<uint8_t> mem;
+
+    // Steps run since construction
+    uint64_t steps;
+
+    // Called for INT, INT3, INTO and divide errors before the interrupt
+    // vector is used. Returns true if it handled the interrupt.
+    std::function<bool(Cpu &, uint8_t)> onInterrupt;
+
+    Cpu();
+
+    // Loads a .COM image at seg:0100 with a PSP whose first bytes are
+    // INT 20h, and a zero return address on the stack
+    void loadCom(const uint8_t *image, size_t size, uint16_t seg);
+
+    // With blocks false every instruction is decoded when it runs
+    Stop run(uint64_t maxSteps, bool blocks = true);
+
+    // For interrupt hooks, run returns EXIT after the current instruction
+    void exit() { exited = true; }
+
+    uint8_t read8(uint32_t linear) const { return mem[linear & memMask]; }
+    uint16_t read16(uint32_t linear) const;
+    void write8(uint32_t linear, uint8_t val);
+    void write16(uint32_t linear, uint16_t val);
+
+    static uint32_t linear(uint16_t seg, uint16_t off) {
+        return ((uint32_t)seg << 4) + off;
+    }
+
+    size_t cachedBlocks() const { return blocks.size(); }
+
+  private:
+    static const uint32_t memMask = memSize - 1;
+    static const size_t maxBlockLen = 32;
+
+    struct Block {
+        std::vector<Uop> uops;
+        std::vector<size_t> pages; // listed in pageBlocks of each
+    };
+
+    const Block &getBlock();
+    void invalidatePage(size_t page);
+    void decodeAt(uint16_t seg, uint16_t off, Instruction &insn,
+                  uint8_t *bytes) const;
+
+    // Executes one uop whose length has already been added to ip. False if
+    // run has to stop, stop says why.
+    bool execute(const Uop &uop);
+
+    // Addressing
+    uint16_t effectiveOffset(const Uop &uop, int &seg) const;
+    uint32_t effectiveAddress(const Uop &uop) const;
+    uint8_t getRM8(const Uop &uop);
+    uint16_t getRM16(const Uop &uop);
+    void setRM8(const Uop &uop, uint8_t val);
+    void setRM16(const Uop &uop, uint16_t val);
+    uint8_t getReg8(size_t r) const;
+    void setReg8(size_t r, uint8_t val);
+
+    void push(uint16_t val);
+    uint16_t pop();
+
+    // Arithmetic with flags, w selects 16 bit
+    uint16_t alu(size_t op, uint16_t a, uint16_t b, bool w);
+    uint16_t shift(size_t op, uint16_t a, uint8_t count, bool w);
+    void setSZP(uint16_t res, bool w);
+    bool condition(uint8_t cc) const;
+
+    bool interrupt(uint8_t vector);
+    bool stringOp(const Uop &uop);
+    bool group3(const Uop &uop, bool w);
+
+    std::unordered_map<uint32_t, Block> blocks;
+
+    // Keys of the blocks with bytes in each page
+    std::vector<std::vector<uint32_t>> pageBlocks;
+
+    // Bytes decoded into a cached block, data next to code stays cheap
+    std::vector<bool> codeBytes;
+
+    // Bumped whenever blocks are dropped, a running block checks it after
+    // every uop
+    uint64_t generation;
+
+    // Segment override of the next uop, -1 for none, and a lone REP prefix
+    int override;
+    uint8_t rep;
+
+    bool exited;
+    Stop stop;
+};
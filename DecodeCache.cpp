@@ -0,0 +1,76 @@
+#include "DecodeCache.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+
+// Matching an opcode may look at up to 3 bytes even when fewer are used,
+// e.g. for DB
+static const size_t minSpan = 3;
+
+DecodeCache::DecodeCache(const uint8_t *decode, size_t size,
+                         uint32_t execOffset)
+    : decode(decode), decodeSize(size), execOffset(execOffset) {}
+
+DecodeCache::Entry &DecodeCache::lookup(uint32_t address) {
+    auto it = entries.lower_bound(address);
+
+    if (it != entries.end() && it->first == address) {
+        return it->second;
+    }
+
+    const size_t offset = address - execOffset;
+
+    if (address < execOffset || offset >= decodeSize) {
+        printf("Address outside of the image\n");
+        throw -1;
+    }
+
+    Entry &entry = entries.emplace_hint(it, address, Entry{})->second;
+    decodeOP(decode + offset, decodeSize - offset, address, entry.insn);
+
+    return entry;
+}
+
+const Instruction &DecodeCache::get(uint32_t address) {
+    return lookup(address).insn;
+}
+
+const Line &DecodeCache::getLine(uint32_t address) {
+    Entry &entry = lookup(address);
+
+    if (!entry.hasLine) {
+        printOP(entry.insn, decode + (address - execOffset), entry.line);
+        entry.hasLine = true;
+    }
+
+    return entry.line;
+}
+
+void DecodeCache::invalidate(uint32_t address, size_t len) {
+    // Nothing starting earlier than this can reach the written range
+    const uint32_t first =
+        address - std::min<uint32_t>(address, maxOPLen - 1);
+    const uint64_t end = (uint64_t)address + len;
+
+    auto it = entries.lower_bound(first);
+
+    while (it != entries.end() && it->first < end) {
+        const size_t span = std::max<size_t>(it->second.insn.len, minSpan);
+
+        if (it->first + span > address) {
+            it = entries.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void DecodeCache::clear() { entries.clear(); }
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+
+#include "Decoder.h"
+#include "Line.h"
+
+// Decoded instructions of an image keyed by address, for a monitor that
+// shows the same windows over and over. The image stays owned by the
+// caller, who calls invalidate after writing to it. Lines are formatted on
+// first use and kept as well.
+class DecodeCache {
+  public:
+    DecodeCache(const uint8_t *decode, size_t size, uint32_t execOffset);
+
+    // The instruction starting at address, which must lie in the image
+    const Instruction &get(uint32_t address);
+    const Line &getLine(uint32_t address);
+
+    // Drops every entry whose decode looked at a byte in
+    // [address, address + len)
+    void invalidate(uint32_t address, size_t len);
+    void clear();
+
+    bool contains(uint32_t address) const {
+        return entries.find(address) != entries.end();
+    }
+    size_t size() const { return entries.size(); }
+
+  private:
+    struct Entry {
+        Instruction insn;
+        bool hasLine;
+        Line line;
+    };
+
+    Entry &lookup(uint32_t address);
+
+    const uint8_t *decode;
+    size_t decodeSize;
+    uint32_t execOffset;
+
+    std::map<uint32_t, Entry> entries;
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// RB,  - Register Byte
+// EB   - Register Byte or Memory (Effective Byte Address)
+// RW   - Register Word
+// EW   - Register Word or Memory (Effective Word Address)
+
+enum class Reg : uint8_t {
+    AL = 0,
+    AX = 0,
+    CL = 1,
+    CX = 1,
+    DL = 2,
+    DX = 2,
+    BL = 3,
+    BX = 3,
+    AH = 4,
+    SP = 4,
+    CH = 5,
+    BP = 5,
+    DH = 6,
+    SI = 6,
+    BH = 7,
+    DI = 7
+};
+
+enum class Width : uint8_t {
+    NONE = 0,
+    BYTE = 1,
+    WORD = 2,
+    DWORD = 4,
+    QWORD = 8
+};
+
+enum class Segment : uint8_t {
+    ES = 0b00,
+    CS = 0b01,
+    SS = 0b10,
+    DS = 0b11,
+    END = 0b100
+};
+
+enum class R_Type : uint8_t {
+    NODISP = 0b00,
+    DISP8 = 0b01,
+    DISP16 = 0b10,
+    REG = 0b11,
+};
+
+enum class Type {
+    NONE = 0,
+    SEG,
+    RB,
+    RW,
+    RMB,
+    RMW,
+    RMDW,
+    RMQW,
+    MEM,
+    RNONE,
+    DB,
+    DW,
+    DEREFBYTEATDW,
+    DEREFWORDATDW,
+    DDW,
+    REGB,
+    REGW,
+    CSEG,
+    AREGB,
+    AREGW,
+    CONSTBYTE,
+    ST,
+    STREG
+};
+
+struct D {
+    Type type;
+    uint32_t num;
+};
+
+struct Description {
+    D d[3]{};
+};
+
+enum class OPExt { NONE, N, FPU_XY, FPU_11 };
+
+struct Op {
+    const char *name;
+    const Description *description;
+    OPExt opExt;
+
+    uint8_t codeSz;
+    uint8_t n;
+    uint8_t code[2];
+
+    Op(const uint8_t (&code2)[2], const char *name,
+       const Description *description, OPExt opExt = OPExt::NONE, uint8_t n = 0)
+        : name(name), description(description), opExt(opExt), codeSz(2), n(n) {
+        memcpy(code, &code2, 2);
+    }
+
+    Op(const uint8_t code2, const char *name, const Description *description,
+       OPExt opExt = OPExt::NONE, uint8_t n = 0)
+        : name(name), description(description), opExt(opExt), codeSz(1), n(n) {
+        code[0] = code2;
+    }
+};
+
+extern const Op ops[];
+extern const size_t opsCount;
+
+// Longest instruction: opcode, ModRM, 16 bit displacement and immediate
+static const size_t maxOPLen = 6;
+
+// How the bytes at an address were decoded
+enum class Status : uint8_t {
+    OP,           // op matched, operands and ModRM fields are filled in
+    TRUNCATED,    // op matched but its operands run past the end, one byte
+    FPU_RESERVED, // reserved FPU encoding, ModRM and displacement are set
+    DB            // no match, one byte
+};
+
+struct Operand {
+    Type type;
+    // Register number, immediate, address or constant depending on the type.
+    // RMB/RMW/RMDW/RMQW/MEM use the ModRM fields of the instruction instead.
+    uint32_t val;
+};
+
+// A decoded instruction, no strings attached
+struct Instruction {
+    uint32_t address;
+    const Op *op; // Points into ops[], nullptr for FPU_RESERVED and DB
+    Operand operands[3];
+    uint16_t disp; // ModRM displacement, or the address for mod 00 r/m 110
+    Width dispWidth;
+    uint8_t len;
+    Status status;
+    bool hasModRM;
+    R_Type mod;
+    uint8_t reg;
+    uint8_t rm;
+};
+
+// Where execution goes after an instruction
+enum class Flow : uint8_t {
+    NEXT,          // Falls through
+    BRANCH,        // Conditional, target or falls through
+    JUMP,          // Target
+    CALL,          // Target, then falls through
+    JUMP_FAR,      // Target is a segment:offset pointer
+    CALL_FAR,      // Target is a segment:offset pointer, then falls through
+    JUMP_INDIRECT, // Register or memory operand
+    CALL_INDIRECT, // Register or memory operand, then falls through
+    RETURN,        // RET, RETF and IRET
+    INVALID        // Not an instruction
+};
+
+Width getDispMemWidth(uint8_t rm, R_Type disp);
+
+const Op *getOP(const uint8_t *cDecode, size_t rem);
+size_t getLen(const Description &description, const uint8_t *decode);
+
+// Decodes the instruction at cDecode, with rem bytes left in the input
+// (rem > 0). Always makes progress, returns insn.len.
+size_t decodeOP(const uint8_t *cDecode, size_t rem, uint32_t address,
+                Instruction &insn);
+
+// Control flow of a decoded instruction. Relative targets stay in the 64k
+// segment of the instruction, far targets are returned as segment:offset.
+// Prefix bytes the decoder lists as DB fall through.
+Flow getFlow(const Instruction &insn, uint32_t &target);
@@ -0,0 +1,78 @@
+#include "Dos.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Cpu.h"
+#include "Output.h"
+
+// Longest $ terminated string printed, guards against a missing $
+static const size_t maxString = 0x10000;
+
+bool dosInterrupt(Cpu &cpu, uint8_t vector, Output *out) {
+    // Divide error with no handler installed, DOS prints and terminates
+    if (vector == 0x00 && cpu.read16(0) == 0 && cpu.read16(2) == 0) {
+        static const char message[] = "Divide overflow\r\n";
+
+        if (out) {
+            out->put(message, sizeof(message) - 1);
+        }
+
+        cpu.exit();
+        return true;
+    }
+
+    if (vector == 0x20) {
+        cpu.exit();
+        return true;
+    }
+
+    if (vector != 0x21) {
+        return false;
+    }
+
+    const uint8_t ah = (uint8_t)(cpu.regs[0] >> 8);
+
+    switch (ah) {
+    case 0x00:
+    case 0x4C:
+        cpu.exit();
+        break;
+    case 0x02: {
+        const char c = (char)cpu.regs[2];
+
+        if (out) {
+            out->put(&c, 1);
+        }
+        break;
+    }
+    case 0x09: {
+        // DS:DX, AL is set to '$' like DOS does
+        const uint16_t ds = cpu.sregs[Cpu::DS];
+
+        for (size_t i = 0; i < maxString; i++) {
+            const char c =
+                (char)cpu.read8(Cpu::linear(ds, (uint16_t)(cpu.regs[2] + i)));
+
+            if (c == '$') {
+                break;
+            }
+
+            if (out) {
+                out->put(&c, 1);
+            }
+        }
+
+        cpu.regs[0] = (cpu.regs[0] & 0xFF00) | '$';
+        break;
+    }
+    case 0x30:
+        // DOS 5.0
+        cpu.regs[0] = 0x0005;
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
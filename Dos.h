@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Cpu.h"
+#include "Output.h"
+
+// The few DOS services small .COM programs use: INT 20h and INT 21h with
+// AH 00h, 02h, 09h, 30h and 4Ch. Console output goes to out, or nowhere if
+// it is null. Meant as Cpu::onInterrupt; other vectors go through the IVT.
+bool dosInterrupt(Cpu &cpu, uint8_t vector, Output *out);
@@ -1,4 +1,3 @@
-
 #include "File.h"
 
 #include <fcntl.h>
@@ -6,8 +5,10 @@
 #include <stdio.h>
 #include <unistd.h>
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <vector>
 
 FileDescriptorRO::FileDescriptorRO(const char *filename) {
@@ -21,6 +22,33 @@ FileDescriptorRO::FileDescriptorRO(const char *filename) {
 
 FileDescriptorRO::~FileDescriptorRO() { close(fd); }
 
+static std::vector<uint8_t> readAll(int fd) {
+    std::vector<uint8_t> buf;
+    size_t len = 0;
+
+    for (;;) {
+        if (buf.size() - len < 4096) {
+            buf.resize(std::max<size_t>(buf.size() * 2, 65536));
+        }
+
+        const ssize_t hasRead = read(fd, buf.data() + len, buf.size() - len);
+
+        if (hasRead == -1) {
+            printf("Cannot read from file\n");
+            throw -1;
+        }
+
+        if (hasRead == 0) {
+            break;
+        }
+
+        len += hasRead;
+    }
+
+    buf.resize(len);
+    return buf;
+}
+
 std::vector<uint8_t> getBuffer(int fd) {
     struct stat statbuf;
     if (fstat(fd, &statbuf) != 0) {
@@ -28,6 +56,11 @@ std::vector<uint8_t> getBuffer(int fd) {
         throw -1;
     }
 
+    // Pipes and devices do not know their size up front
+    if (!S_ISREG(statbuf.st_mode)) {
+        return readAll(fd);
+    }
+
     std::vector<uint8_t> buf(statbuf.st_size);
 
     const ssize_t hasRead = read(fd, buf.data(), buf.size());
@@ -44,3 +77,40 @@ std::vector<uint8_t> getBuffer(int fd) {
 
     return buf;
 }
+
+FileView::FileView(int fd, bool sequential)
+    : map(nullptr), ptr(nullptr), len(0) {
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) != 0) {
+        printf("Cannot open file\n");
+        throw -1;
+    }
+
+    if (!S_ISREG(statbuf.st_mode) || statbuf.st_size == 0) {
+        buf = getBuffer(fd);
+        ptr = buf.data();
+        len = buf.size();
+        return;
+    }
+
+    len = statbuf.st_size;
+    map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        printf("Cannot map file\n");
+        throw -1;
+    }
+
+    if (sequential) {
+        madvise(map, len, MADV_SEQUENTIAL);
+    }
+
+    ptr = (const uint8_t *)map;
+}
+
+FileView::~FileView() {
+    if (map) {
+        munmap(map, len);
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
@@ -12,3 +13,25 @@ class FileDescriptorRO {
 };
 
 std::vector<uint8_t> getBuffer(int fd);
+
+// Read-only view of a whole file. Regular files are mapped, everything else
+// (pipes, character devices) goes through getBuffer. The view stays valid
+// after the descriptor is closed.
+class FileView {
+  public:
+    // sequential hints the kernel that the file is read front to back
+    explicit FileView(int fd, bool sequential = true);
+    ~FileView();
+
+    FileView(const FileView &) = delete;
+    FileView &operator=(const FileView &) = delete;
+
+    const uint8_t *data() const { return ptr; }
+    size_t size() const { return len; }
+
+  private:
+    void *map;
+    const uint8_t *ptr;
+    size_t len;
+    std::vector<uint8_t> buf;
+};
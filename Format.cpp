@@ -0,0 +1,187 @@
+#include "Format.h"
+
+#include "Decoder.h"
+#include "Line.h"
+#include "Probe.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const char *rb[] = {"AL", "CL", "DL", "BL", "AH", "CH", "DH", "BH"};
+static const char *rw[] = {"AX", "CX", "DX", "BX", "SP", "BP", "SI", "DI"};
+static const char *segments[] = {"ES", "CS", "SS", "DS"};
+
+static const char *modNames[]{
+    "BX + SI", "BX + DI", "BP + SI", "BP + DI", "SI", "DI", "BP", "BX",
+};
+
+static const char *getWidthName(Width width) {
+    switch (width) {
+    case Width::BYTE:
+        return "BYTE";
+    case Width::WORD:
+        return "WORD";
+    case Width::DWORD:
+        return "DWORD";
+    case Width::QWORD:
+        return "QWORD";
+    default:
+        return "MEM";
+    }
+}
+
+static void printRM(const Instruction &insn, Width regWidth, Line &line) {
+    if (insn.mod == R_Type::NODISP && insn.rm == 0b110) {
+        line << getWidthName(regWidth) << " [" << Num{insn.disp, HEX2} << "]";
+
+    } else if (insn.mod == R_Type::REG) {
+        if (regWidth == Width::BYTE) {
+            line << rb[insn.rm];
+        } else {
+            line << rw[insn.rm];
+        }
+    } else {
+        line << getWidthName(regWidth) << " [" << modNames[insn.rm];
+
+        if (insn.dispWidth == Width::BYTE) {
+            line << " + " << Num{insn.disp, HEX1};
+        } else if (insn.dispWidth == Width::WORD) {
+            line << " + " << Num{insn.disp, HEX2};
+        }
+
+        line << "]";
+    }
+}
+
+void printOperand(const Instruction &insn, const Operand &operand,
+                  Line &line) {
+    const uint32_t val = operand.val;
+
+    switch (operand.type) {
+    case Type::RMB:
+        printRM(insn, Width::BYTE, line);
+        break;
+    case Type::RMW:
+        printRM(insn, Width::WORD, line);
+        break;
+    case Type::RMDW:
+        printRM(insn, Width::DWORD, line);
+        break;
+    case Type::RMQW:
+        printRM(insn, Width::QWORD, line);
+        break;
+    case Type::MEM:
+        printRM(insn, Width::NONE, line);
+        break;
+    case Type::DB:
+        line << "BYTE " << Num{val, HEX1};
+        break;
+    case Type::DW:
+        line << "WORD " << Num{val, HEX2};
+        break;
+    case Type::DEREFBYTEATDW:
+        line << "BYTE [" << Num{val, HEX2} << "]";
+        break;
+    case Type::DEREFWORDATDW:
+        line << "WORD [" << Num{val, HEX2} << "]";
+        break;
+    case Type::RB:
+    case Type::REGB:
+        line << rb[val];
+        break;
+    case Type::RW:
+    case Type::REGW:
+        line << rw[val];
+        break;
+    case Type::SEG:
+        if (val < (uint8_t)Segment::END) {
+            line << segments[val];
+        } else {
+            line << "?";
+        }
+        break;
+    case Type::CONSTBYTE:
+        line << Num{val, DEC};
+        break;
+    case Type::CSEG:
+        line << segments[val];
+        break;
+    case Type::DDW:
+        line << "DWORD " << Num{val, HEX4};
+        break;
+    case Type::ST:
+        line << "ST";
+        break;
+    case Type::STREG:
+        line << "ST" << Num{val, DEC};
+        break;
+    default:
+        break;
+    }
+}
+
+void printDescription(const Instruction &insn, Line &line) {
+    PROBE_TIME(Probe::DESCRIPTION_CALLS, Probe::DESCRIPTION_NS);
+
+    bool first = true;
+
+    for (const Operand &operand : insn.operands) {
+        if (operand.type == Type::NONE) {
+            continue;
+        }
+
+        if (first) {
+            line << " ";
+            first = false;
+        } else {
+            line << ", ";
+        }
+
+        printOperand(insn, operand, line);
+    }
+}
+
+void printOP(const Instruction &insn, const uint8_t *cDecode, Line &line) {
+    line << Num{insn.address, HEX4} << ":  ";
+
+    for (size_t i = 0; i < insn.len; i++) {
+        line << Num{cDecode[i], HEX1_NO_DECORATION} << " ";
+    }
+
+    line << "; " << Pad{36};
+
+    switch (insn.status) {
+    case Status::OP:
+        line << insn.op->name << Pad{50};
+        printDescription(insn, line);
+        break;
+    case Status::TRUNCATED:
+        line << "DB " << Pad{50} << " " << Num{cDecode[0], HEX1};
+        break;
+    case Status::FPU_RESERVED:
+        line << "FPU RESERVED";
+        break;
+    case Status::DB:
+        line << "DB " << Num{cDecode[0], HEX1};
+        break;
+    }
+}
+
+void printData(uint32_t address, const uint8_t *cDecode, size_t len,
+               Line &line) {
+    line << Num{address, HEX4} << ":  ";
+
+    for (size_t i = 0; i < len; i++) {
+        line << Num{cDecode[i], HEX1_NO_DECORATION} << " ";
+    }
+
+    line << "; " << Pad{36} << "DB ";
+
+    for (size_t i = 0; i < len; i++) {
+        if (i > 0) {
+            line << ", ";
+        }
+
+        line << Num{cDecode[i], HEX1};
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Decoder.h"
+#include "Line.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One operand as it appears in the listing, operand.type is not NONE
+void printOperand(const Instruction &insn, const Operand &operand,
+                  Line &line);
+
+// The operands separated by commas, with a leading space
+void printDescription(const Instruction &insn, Line &line);
+
+// Formats insn as "addr: hexbytes ; mnemonic [operands]", cDecode points to
+// the insn.len bytes it was decoded from
+void printOP(const Instruction &insn, const uint8_t *cDecode, Line &line);
+
+// Formats up to 4 bytes of data as "addr: hexbytes ; DB bytes"
+void printData(uint32_t address, const uint8_t *cDecode, size_t len,
+               Line &line);
@@ -0,0 +1,399 @@
+#include "Graph.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+#include "Output.h"
+
+static const uint32_t none = UINT32_MAX;
+
+// One function as a worker finds it, offsets into the image and block
+// indices local to the function
+struct Explored {
+    uint32_t entry;
+
+    std::vector<BasicBlock> blocks;
+    std::vector<Edge> edges;
+    std::vector<Call> calls; // callee is the offset of the target
+};
+
+struct Step {
+    uint32_t offset;
+    uint32_t target; // offset, none if there is none or it is outside
+    uint8_t len;
+    Flow flow;
+};
+
+static bool endsBlock(Flow flow) {
+    return flow != Flow::NEXT && flow != Flow::CALL &&
+           flow != Flow::CALL_FAR && flow != Flow::CALL_INDIRECT;
+}
+
+static void explore(const uint8_t *decode, size_t size, uint32_t execOffset,
+                    Explored &fn) {
+    std::vector<Step> steps;
+    std::vector<uint32_t> leaders{fn.entry};
+    std::vector<uint32_t> work{fn.entry};
+    std::unordered_set<uint32_t> seen;
+
+    while (!work.empty()) {
+        size_t offset = work.back();
+        work.pop_back();
+
+        while (offset < size && seen.insert(offset).second) {
+            Instruction insn;
+            decodeOP(decode + offset, size - offset, execOffset + offset,
+                     insn);
+
+            uint32_t target;
+            const Flow flow = getFlow(insn, target);
+
+            if (flow == Flow::INVALID) {
+                break;
+            }
+
+            const uint32_t targetOffset = target - execOffset;
+            const bool inside = target >= execOffset && targetOffset < size &&
+                                (flow == Flow::BRANCH || flow == Flow::JUMP ||
+                                 flow == Flow::CALL);
+
+            steps.push_back({(uint32_t)offset, inside ? targetOffset : none,
+                             insn.len, flow});
+
+            if (inside && flow != Flow::CALL) {
+                leaders.push_back(targetOffset);
+                work.push_back(targetOffset);
+            }
+
+            offset += insn.len;
+
+            if (flow == Flow::BRANCH) {
+                leaders.push_back(offset);
+            } else if (endsBlock(flow)) {
+                break;
+            }
+        }
+    }
+
+    std::sort(steps.begin(), steps.end(),
+              [](const Step &a, const Step &b) { return a.offset < b.offset; });
+    std::sort(leaders.begin(), leaders.end());
+
+    // Last step of every block, to add the edges once the blocks are known
+    std::vector<const Step *> lasts;
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        const Step &step = steps[i];
+        const Step *prev = i ? &steps[i - 1] : nullptr;
+
+        const bool starts =
+            !prev || prev->offset + prev->len != step.offset ||
+            endsBlock(prev->flow) ||
+            std::binary_search(leaders.begin(), leaders.end(), step.offset);
+
+        if (starts) {
+            fn.blocks.push_back({step.offset, 0, 0, 0});
+            lasts.push_back(nullptr);
+        }
+
+        BasicBlock &block = fn.blocks.back();
+        block.len += step.len;
+        block.insns++;
+        lasts.back() = &step;
+
+        if (step.flow == Flow::CALL && step.target != none) {
+            fn.calls.push_back({(uint32_t)fn.blocks.size() - 1, step.target});
+        }
+    }
+
+    auto find = [&](uint32_t offset) {
+        auto it = std::lower_bound(fn.blocks.begin(), fn.blocks.end(), offset,
+                                   [](const BasicBlock &block, uint32_t off) {
+                                       return block.address < off;
+                                   });
+
+        return it != fn.blocks.end() && it->address == offset
+                   ? (uint32_t)(it - fn.blocks.begin())
+                   : none;
+    };
+
+    auto addEdge = [&](uint32_t from, uint32_t offset, EdgeKind kind) {
+        const uint32_t to = offset == none ? none : find(offset);
+
+        if (to != none) {
+            fn.edges.push_back({from, to, kind, {}});
+        }
+    };
+
+    for (uint32_t b = 0; b < fn.blocks.size(); b++) {
+        const Step &last = *lasts[b];
+        const uint32_t next = last.offset + last.len;
+
+        switch (last.flow) {
+        case Flow::BRANCH:
+            addEdge(b, last.target, EdgeKind::BRANCH);
+            addEdge(b, next, EdgeKind::FALLTHROUGH);
+            break;
+        case Flow::JUMP:
+            addEdge(b, last.target, EdgeKind::JUMP);
+            break;
+        default:
+            if (!endsBlock(last.flow)) {
+                addEdge(b, next, EdgeKind::FALLTHROUGH);
+            }
+            break;
+        }
+    }
+}
+
+Graph buildGraph(const uint8_t *decode, size_t size, uint32_t execOffset,
+                 const std::vector<uint32_t> &entries, size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+
+    // Functions in the order they were found, with a stable address each
+    std::deque<Explored> found;
+    std::vector<bool> known(size);
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t next = 0;
+    size_t busy = 0;
+
+    auto addFunction = [&](uint32_t offset) {
+        if (!known[offset]) {
+            known[offset] = true;
+            found.emplace_back();
+            found.back().entry = offset;
+        }
+    };
+
+    for (uint32_t entry : entries) {
+        const uint32_t offset = entry - execOffset;
+
+        if (entry >= execOffset && offset < size) {
+            addFunction(offset);
+        }
+    }
+
+    auto worker = [&]() {
+        for (;;) {
+            Explored *fn;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() {
+                    return next < found.size() || busy == 0;
+                });
+
+                if (next >= found.size()) {
+                    return;
+                }
+
+                fn = &found[next++];
+                busy++;
+            }
+
+            explore(decode, size, execOffset, *fn);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                for (const Call &call : fn->calls) {
+                    addFunction(call.callee);
+                }
+
+                busy--;
+            }
+
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    for (std::thread &t : workers) {
+        t.join();
+    }
+
+    std::vector<const Explored *> order;
+
+    for (const Explored &fn : found) {
+        order.push_back(&fn);
+    }
+
+    std::sort(order.begin(), order.end(),
+              [](const Explored *a, const Explored *b) {
+                  return a->entry < b->entry;
+              });
+
+    Graph graph;
+
+    auto callee = [&](uint32_t offset) {
+        auto it = std::lower_bound(order.begin(), order.end(), offset,
+                                   [](const Explored *fn, uint32_t off) {
+                                       return fn->entry < off;
+                                   });
+
+        return (uint32_t)(it - order.begin());
+    };
+
+    for (const Explored *fn : order) {
+        const uint32_t index = (uint32_t)graph.functions.size();
+        const uint32_t base = (uint32_t)graph.blocks.size();
+
+        graph.functions.push_back(
+            {execOffset + fn->entry, base, (uint32_t)fn->blocks.size()});
+
+        for (BasicBlock block : fn->blocks) {
+            block.address += execOffset;
+            block.function = index;
+            graph.blocks.push_back(block);
+        }
+
+        for (Edge edge : fn->edges) {
+            edge.from += base;
+            edge.to += base;
+            graph.edges.push_back(edge);
+        }
+
+        for (const Call &call : fn->calls) {
+            graph.calls.push_back({base + call.from, callee(call.callee)});
+        }
+    }
+
+    return graph;
+}
+
+static const char *getEdgeStyle(EdgeKind kind) {
+    switch (kind) {
+    case EdgeKind::FALLTHROUGH:
+        return "";
+    case EdgeKind::BRANCH:
+        return " [color=green]";
+    case EdgeKind::JUMP:
+        return " [color=blue]";
+    }
+
+    return "";
+}
+
+void writeDot(const Graph &graph, const uint8_t *decode, size_t size,
+              uint32_t execOffset, Output &out) {
+    Line line{};
+    line << "digraph cfg {\n"
+         << "    node [shape=box fontname=monospace];\n";
+    out.put(line.text, line.len);
+
+    for (size_t f = 0; f < graph.functions.size(); f++) {
+        const Function &fn = graph.functions[f];
+
+        line.len = 0;
+        line << "    subgraph cluster_" << Num{(uint32_t)f, UDEC}
+             << " {\n        label=\"" << Num{fn.entry, HEX4} << "\";\n";
+        out.put(line.text, line.len);
+
+        for (uint32_t b = fn.firstBlock; b < fn.firstBlock + fn.blockCount;
+             b++) {
+            const BasicBlock &block = graph.blocks[b];
+
+            line.len = 0;
+            line << "        b" << Num{b, UDEC} << " [label=\"";
+            out.put(line.text, line.len);
+
+            // One line per instruction, left aligned with \l
+            size_t offset = block.address - execOffset;
+
+            for (uint32_t i = 0; i < block.insns && offset < size; i++) {
+                Instruction insn;
+                decodeOP(decode + offset, size - offset, execOffset + offset,
+                         insn);
+
+                line.len = 0;
+                line << Num{insn.address, HEX4} << "  ";
+
+                // Same wording as the listing for bytes that are not code
+                switch (insn.status) {
+                case Status::OP:
+                    line << insn.op->name;
+                    printDescription(insn, line);
+                    break;
+                case Status::FPU_RESERVED:
+                    line << "FPU RESERVED";
+                    break;
+                case Status::TRUNCATED:
+                case Status::DB:
+                    line << "DB " << Num{decode[offset], HEX1};
+                    break;
+                }
+
+                line << "\\l";
+                out.put(line.text, line.len);
+
+                offset += insn.len;
+            }
+
+            out.put("\"];\n", 4);
+        }
+
+        out.put("    }\n", 6);
+    }
+
+    for (const Edge &edge : graph.edges) {
+        line.len = 0;
+        line << "    b" << Num{edge.from, UDEC} << " -> b"
+             << Num{edge.to, UDEC} << getEdgeStyle(edge.kind) << ";\n";
+        out.put(line.text, line.len);
+    }
+
+    for (const Call &call : graph.calls) {
+        const Function &callee = graph.functions[call.callee];
+
+        // Nothing decodable at the target
+        if (callee.blockCount == 0) {
+            continue;
+        }
+
+        line.len = 0;
+        line << "    b" << Num{call.from, UDEC} << " -> b"
+             << Num{callee.firstBlock, UDEC}
+             << " [style=dashed];\n";
+        out.put(line.text, line.len);
+    }
+
+    out.put("}\n", 2);
+}
+
+void writeGraph(const Graph &graph, Output &out) {
+    GraphHeader header;
+    memcpy(header.magic, "CFG1", 4);
+    header.functions = (uint32_t)graph.functions.size();
+    header.blocks = (uint32_t)graph.blocks.size();
+    header.edges = (uint32_t)graph.edges.size();
+    header.calls = (uint32_t)graph.calls.size();
+
+    out.put((const char *)&header, sizeof(header));
+    out.put((const char *)graph.functions.data(),
+            graph.functions.size() * sizeof(Function));
+    out.put((const char *)graph.blocks.data(),
+            graph.blocks.size() * sizeof(BasicBlock));
+    out.put((const char *)graph.edges.data(),
+            graph.edges.size() * sizeof(Edge));
+    out.put((const char *)graph.calls.data(),
+            graph.calls.size() * sizeof(Call));
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Output.h"
+
+enum class EdgeKind : uint8_t {
+    FALLTHROUGH, // next instruction, also after a not taken branch
+    BRANCH,      // taken conditional jump, LOOP or JCXZ
+    JUMP         // near JMP
+};
+
+// The structs below are also the records of the binary graph file, host byte
+// order: a GraphHeader followed by the functions, blocks, edges and calls
+// arrays with the counts of the header.
+
+struct GraphHeader {
+    char magic[4]; // "CFG1"
+    uint32_t functions;
+    uint32_t blocks;
+    uint32_t edges;
+    uint32_t calls;
+};
+
+struct Function {
+    uint32_t entry;
+    uint32_t firstBlock; // blocks of a function are consecutive
+    uint32_t blockCount;
+};
+
+// Instructions from address up to address + len, the first one is a branch
+// target or follows a block end, only the last one may change control flow
+struct BasicBlock {
+    uint32_t address;
+    uint32_t len;
+    uint32_t insns;
+    uint32_t function;
+};
+
+// Between blocks of the same function
+struct Edge {
+    uint32_t from;
+    uint32_t to;
+    EdgeKind kind;
+    uint8_t reserved[3];
+};
+
+// From the block holding a near CALL to the called function
+struct Call {
+    uint32_t from;
+    uint32_t callee;
+};
+
+static_assert(sizeof(GraphHeader) == 20, "GraphHeader layout changed");
+static_assert(sizeof(Function) == 12, "Function layout changed");
+static_assert(sizeof(BasicBlock) == 16, "BasicBlock layout changed");
+static_assert(sizeof(Edge) == 12, "Edge layout changed");
+static_assert(sizeof(Call) == 8, "Call layout changed");
+
+// Functions sorted by entry, their blocks sorted by address. Code reached
+// from several functions, like shared tails, is in the blocks of each.
+struct Graph {
+    std::vector<Function> functions;
+    std::vector<BasicBlock> blocks;
+    std::vector<Edge> edges;
+    std::vector<Call> calls;
+};
+
+// Functions start at the entries and at the targets of near CALLs inside the
+// image. Each function is explored like traverse does, following branches
+// and jumps but not calls, on threads workers which pick up new functions as
+// calls to them are found.
+Graph buildGraph(const uint8_t *decode, size_t size, uint32_t execOffset,
+                 const std::vector<uint32_t> &entries, size_t threads);
+
+// Graphviz, one cluster per function with the instructions in the nodes
+void writeDot(const Graph &graph, const uint8_t *decode, size_t size,
+              uint32_t execOffset, Output &out);
+
+// The binary graph file described above
+void writeGraph(const Graph &graph, Output &out);
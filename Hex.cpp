@@ -0,0 +1,344 @@
+#include "Hex.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+static int hexDigit(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+// One record (line) at a time, hex pairs are decoded on the fly
+class RecordReader {
+  public:
+    RecordReader(const uint8_t *text, size_t size)
+        : text(text), size(size), pos(0), end(0), lineNo(0) {}
+
+    // Moves to the next non-empty line, returns its first character or 0
+    uint8_t next() {
+        pos = end;
+
+        while (pos < size &&
+               (text[pos] == '\n' || text[pos] == '\r' || text[pos] == ' ' ||
+                text[pos] == '\t')) {
+            if (text[pos] == '\n') {
+                lineNo++;
+            }
+
+            pos++;
+        }
+
+        if (pos >= size) {
+            return 0;
+        }
+
+        end = pos;
+
+        while (end < size && text[end] != '\n' && text[end] != '\r') {
+            end++;
+        }
+
+        lineNo++;
+        return text[pos++];
+    }
+
+    uint8_t byte() {
+        if (end - pos < 2) {
+            fail("Record too short");
+        }
+
+        const int hi = hexDigit(text[pos]);
+        const int lo = hexDigit(text[pos + 1]);
+
+        if (hi < 0 || lo < 0) {
+            fail("Invalid hex digit");
+        }
+
+        pos += 2;
+        return (uint8_t)(hi << 4 | lo);
+    }
+
+    uint8_t digit() {
+        const int d = pos < end ? hexDigit(text[pos]) : -1;
+
+        if (d < 0) {
+            fail("Invalid hex digit");
+        }
+
+        pos++;
+        return (uint8_t)d;
+    }
+
+    // Only whitespace may follow the record
+    void finish() {
+        while (pos < end && (text[pos] == ' ' || text[pos] == '\t')) {
+            pos++;
+        }
+
+        if (pos != end) {
+            fail("Trailing characters after record");
+        }
+    }
+
+    [[noreturn]] void fail(const char *what) const {
+        printf("%s in line %zu\n", what, lineNo);
+        throw -1;
+    }
+
+  private:
+    const uint8_t *text;
+    size_t size;
+    size_t pos;
+    size_t end;
+    size_t lineNo;
+};
+
+// Appends to the last region while records are contiguous, which is how
+// almost every file is written
+static std::vector<uint8_t> &regionAt(std::vector<Region> &regions,
+                                      uint32_t address) {
+    if (regions.empty() || regions.back().address +
+                                   regions.back().data.size() !=
+                               address) {
+        regions.push_back({address, {}});
+    }
+
+    return regions.back().data;
+}
+
+static void merge(HexImage &image) {
+    std::vector<Region> &regions = image.regions;
+
+    regions.erase(std::remove_if(regions.begin(), regions.end(),
+                                 [](const Region &region) {
+                                     return region.data.empty();
+                                 }),
+                  regions.end());
+
+    // Usually the file is written in address order without overlaps and
+    // the regions are already final
+    bool ordered = true;
+
+    for (size_t i = 1; i < regions.size() && ordered; i++) {
+        const Region &prev = regions[i - 1];
+        ordered = (uint64_t)prev.address + prev.data.size() <
+                  regions[i].address;
+    }
+
+    if (ordered) {
+        return;
+    }
+
+    std::vector<size_t> order(regions.size());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return regions[a].address < regions[b].address;
+    });
+
+    // Lay out the merged regions in address order first
+    std::vector<Region> merged;
+
+    for (size_t i : order) {
+        const Region &region = regions[i];
+
+        if (merged.empty() ||
+            (uint64_t)merged.back().address + merged.back().data.size() <
+                region.address) {
+            merged.push_back({region.address, {}});
+        }
+
+        // Overlaps or touches the previous one
+        Region &prev = merged.back();
+        const size_t at = region.address - prev.address;
+
+        if (prev.data.size() < at + region.data.size()) {
+            prev.data.resize(at + region.data.size());
+        }
+    }
+
+    // Then fill them in file order, so later records win
+    for (const Region &region : regions) {
+        auto it = std::upper_bound(merged.begin(), merged.end(),
+                                   region.address,
+                                   [](uint32_t address, const Region &r) {
+                                       return address < r.address;
+                                   });
+        Region &into = *(it - 1);
+
+        std::copy(region.data.begin(), region.data.end(),
+                  into.data.begin() + (region.address - into.address));
+    }
+
+    regions = std::move(merged);
+}
+
+static void loadIntel(RecordReader &reader, HexImage &image) {
+    uint32_t base = 0;
+    bool segmented = false;
+
+    for (uint8_t c = reader.next(); c != 0; c = reader.next()) {
+        if (c != ':') {
+            reader.fail("Record does not start with ':'");
+        }
+
+        const uint8_t count = reader.byte();
+        const uint8_t addrHi = reader.byte();
+        const uint8_t addrLo = reader.byte();
+        const uint8_t type = reader.byte();
+
+        uint8_t sum = count + addrHi + addrLo + type;
+        const uint16_t offset = addrHi << 8 | addrLo;
+
+        if (type == 0x00) {
+            std::vector<uint8_t> *data = nullptr;
+
+            for (size_t i = 0; i < count; i++) {
+                // Segmented addresses wrap around within the segment
+                const uint16_t at = offset + i;
+
+                if (!data || (segmented && at == 0)) {
+                    const uint32_t address =
+                        segmented ? base + at : base + offset + i;
+                    data = &regionAt(image.regions, address);
+                }
+
+                const uint8_t b = reader.byte();
+                sum += b;
+                data->push_back(b);
+            }
+        } else {
+            uint8_t buf[4];
+
+            if (count > sizeof(buf)) {
+                reader.fail("Record too long");
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                buf[i] = reader.byte();
+                sum += buf[i];
+            }
+
+            if (type == 0x02 && count == 2) {
+                base = (buf[0] << 8 | buf[1]) << 4;
+                segmented = true;
+            } else if (type == 0x04 && count == 2) {
+                base = (uint32_t)(buf[0] << 8 | buf[1]) << 16;
+                segmented = false;
+            } else if (type == 0x03 && count == 4) {
+                image.hasStart = true;
+                image.start = ((buf[0] << 8 | buf[1]) << 4) +
+                              (buf[2] << 8 | buf[3]);
+            } else if (type == 0x05 && count == 4) {
+                image.hasStart = true;
+                image.start = (uint32_t)buf[0] << 24 | buf[1] << 16 |
+                              buf[2] << 8 | buf[3];
+            } else if (type != 0x01 || count != 0) {
+                reader.fail("Unknown record");
+            }
+        }
+
+        sum += reader.byte();
+        reader.finish();
+
+        if (sum != 0) {
+            reader.fail("Checksum mismatch");
+        }
+
+        if (type == 0x01) {
+            break;
+        }
+    }
+}
+
+static void loadSRecord(RecordReader &reader, HexImage &image) {
+    for (uint8_t c = reader.next(); c != 0; c = reader.next()) {
+        if (c != 'S') {
+            reader.fail("Record does not start with 'S'");
+        }
+
+        const uint8_t type = reader.digit();
+        const uint8_t count = reader.byte();
+
+        // Address length of S0-S9, 0 for reserved types
+        static const uint8_t addrLens[] = {2, 2, 3, 4, 0, 2, 3, 4, 3, 2};
+        const size_t addrLen = type < 10 ? addrLens[type] : 0;
+
+        if (addrLen == 0 || count < addrLen + 1) {
+            reader.fail("Unknown record");
+        }
+
+        uint8_t sum = count;
+        uint32_t address = 0;
+
+        for (size_t i = 0; i < addrLen; i++) {
+            const uint8_t b = reader.byte();
+            sum += b;
+            address = address << 8 | b;
+        }
+
+        const size_t dataLen = count - addrLen - 1;
+        std::vector<uint8_t> *data = nullptr;
+
+        if (type >= 1 && type <= 3) {
+            data = &regionAt(image.regions, address);
+        } else if (type >= 7) {
+            image.hasStart = true;
+            image.start = address;
+        }
+
+        for (size_t i = 0; i < dataLen; i++) {
+            const uint8_t b = reader.byte();
+            sum += b;
+
+            if (data) {
+                data->push_back(b);
+            }
+        }
+
+        sum += reader.byte();
+        reader.finish();
+
+        if (sum != 0xFF) {
+            reader.fail("Checksum mismatch");
+        }
+
+        if (type >= 7) {
+            break;
+        }
+    }
+}
+
+HexImage loadHex(const uint8_t *text, size_t size) {
+    HexImage image{};
+    RecordReader reader(text, size);
+
+    // Peek at the first record to tell the formats apart
+    const uint8_t first = RecordReader(text, size).next();
+
+    if (first == ':') {
+        loadIntel(reader, image);
+    } else if (first == 'S') {
+        loadSRecord(reader, image);
+    } else {
+        printf("Neither Intel HEX nor S-records\n");
+        throw -1;
+    }
+
+    merge(image);
+    return image;
+}
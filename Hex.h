@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// A contiguous run of bytes loaded at address
+struct Region {
+    uint32_t address;
+    std::vector<uint8_t> data;
+};
+
+struct HexImage {
+    // Sorted by address, adjacent and overlapping records are merged (later
+    // records win)
+    std::vector<Region> regions;
+
+    bool hasStart;
+    uint32_t start; // Linear start address (CS * 16 + IP for segments)
+};
+
+// Parses Intel HEX (record types 00-05) or Motorola S-records (S0-S9),
+// whichever the text starts with. Record data goes straight into the
+// regions. Throws on malformed records and checksum errors.
+HexImage loadHex(const uint8_t *text, size_t size);
@@ -0,0 +1,215 @@
+#include "Length.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "Decoder.h"
+#include "Probe.h"
+
+// Every instruction is at most 6 bytes. With this much input left nothing
+// can be truncated, so the length only depends on the bytes themselves.
+static const size_t fastRem = 8;
+
+typedef uint8_t V16 __attribute__((vector_size(16)));
+
+// Length classes, one byte each. Bits 0-3 hold the length without the
+// displacement, bits 4-5 the position of the ModRM byte whose displacement
+// is added (0 = none). SLOW entries depend on more than the first two
+// bytes and go through decodeOP. The class of an instruction is
+// rows[rowOf[first byte]][second byte]; most first bytes do not care about
+// the second one and share a row filled with a single class.
+class LengthTable {
+  public:
+    static constexpr uint8_t SLOW = 0x80;
+
+    uint8_t rowOf[256];
+    std::vector<std::array<uint8_t, 256>> rows;
+
+    uint8_t dispLen[256];
+
+    LengthTable() {
+        // Decodes every pair of first bytes, which no probe should count
+        PROBE_PAUSE();
+
+        for (size_t b = 0; b < 256; b++) {
+            const R_Type mod = (R_Type)(b >> 6);
+            dispLen[b] = (uint8_t)getDispMemWidth(b & 0b111, mod);
+        }
+
+        // Matching only looks at the third byte for two byte opcodes with a
+        // ModRM extension
+        std::vector<bool> third(256 * 256);
+
+        for (size_t i = 0; i < opsCount; i++) {
+            const Op &op = ops[i];
+
+            if (op.codeSz == 2 && op.opExt != OPExt::NONE) {
+                third[op.code[0] * 256 + op.code[1]] = true;
+            }
+        }
+
+        std::array<uint8_t, 256> row;
+
+        for (size_t b0 = 0; b0 < 256; b0++) {
+            for (size_t b1 = 0; b1 < 256; b1++) {
+                row[b1] = classify(b0, b1, third[b0 * 256 + b1]);
+            }
+
+            auto it = std::find(rows.begin(), rows.end(), row);
+            rowOf[b0] = (uint8_t)(it - rows.begin());
+
+            if (it == rows.end()) {
+                rows.push_back(row);
+            }
+        }
+    }
+
+    uint8_t entry(const uint8_t *cDecode) const {
+        return rows[rowOf[cDecode[0]]][cDecode[1]];
+    }
+
+  private:
+    uint8_t formula(const uint8_t *buf) const {
+        Instruction insn;
+        decodeOP(buf, fastRem, 0, insn);
+
+        size_t pos = 0;
+
+        if (insn.status == Status::FPU_RESERVED) {
+            pos = 1;
+        } else if (insn.status == Status::OP) {
+            for (const Operand &operand : insn.operands) {
+                if (operand.type == Type::RMB || operand.type == Type::RMW ||
+                    operand.type == Type::RMDW ||
+                    operand.type == Type::RMQW || operand.type == Type::MEM) {
+                    pos = insn.op->codeSz;
+                    break;
+                }
+            }
+        }
+
+        const size_t n = insn.len - (pos ? dispLen[buf[pos]] : 0);
+        return (uint8_t)(n | (pos << 4));
+    }
+
+    uint8_t classify(size_t b0, size_t b1, bool third) const {
+        uint8_t buf[fastRem]{(uint8_t)b0, (uint8_t)b1};
+
+        const uint8_t e = formula(buf);
+
+        if (!third) {
+            return e;
+        }
+
+        for (size_t b2 = 1; b2 < 256; b2++) {
+            buf[2] = (uint8_t)b2;
+
+            if (formula(buf) != e) {
+                return SLOW;
+            }
+        }
+
+        return e;
+    }
+};
+
+static const LengthTable &getLengthTable() {
+    static const LengthTable table;
+    return table;
+}
+
+size_t getOPLen(const uint8_t *cDecode, size_t rem) {
+    const LengthTable &table = getLengthTable();
+
+    if (rem >= fastRem) {
+        const uint8_t e = table.entry(cDecode);
+
+        if (!(e & LengthTable::SLOW)) {
+            const size_t pos = e >> 4;
+            return (e & 0xF) + (pos ? table.dispLen[cDecode[pos]] : 0);
+        }
+    }
+
+    Instruction insn;
+    return decodeOP(cDecode, rem, 0, insn);
+}
+
+// Displacement length of every byte in the block if it were a ModRM byte,
+// 16 bytes at a time
+static void classifyModRM(const uint8_t *block, size_t len, uint8_t *disp) {
+    size_t i = 0;
+
+    for (; i + sizeof(V16) <= len; i += sizeof(V16)) {
+        V16 b;
+        memcpy(&b, block + i, sizeof(b));
+
+        const V16 mod = b >> 6;
+        const V16 rm = b & 0b111;
+
+        const V16 disp8 = (V16)(mod == 1) & 1;
+        const V16 disp16 = (V16)((mod == 2) | ((mod == 0) & (rm == 6))) & 2;
+
+        const V16 res = disp8 | disp16;
+        memcpy(disp + i, &res, sizeof(res));
+    }
+
+    const LengthTable &table = getLengthTable();
+
+    for (; i < len; i++) {
+        disp[i] = table.dispLen[block[i]];
+    }
+}
+
+// The lengths at every offset of a block do not depend on each other, only
+// the walk from one start to the next does. That walk is one dependent load
+// per instruction and bounds the sweep; classifying every byte up front
+// keeps table lookups and decodeOP off it.
+std::vector<uint32_t> getBoundaries(const uint8_t *decode, size_t size) {
+    static const size_t blockSize = 4096;
+
+    const LengthTable &table = getLengthTable();
+
+    std::vector<uint32_t> starts;
+    starts.reserve(size / 2);
+
+    // Per offset of the block: displacement if it were ModRM, then the
+    // length of an instruction starting there (0 = ask decodeOP)
+    uint8_t disp[blockSize + fastRem];
+    uint8_t lens[blockSize];
+
+    size_t offset = 0;
+
+    for (size_t base = 0; base + blockSize + fastRem <= size;
+         base += blockSize) {
+        const uint8_t *block = decode + base;
+
+        classifyModRM(block, blockSize + 2, disp);
+
+        for (size_t i = 0; i < blockSize; i++) {
+            const uint8_t e = table.entry(block + i);
+            const size_t pos = (e >> 4) & 0b11;
+            const uint8_t len = (e & 0xF) + (pos != 0) * disp[i + pos];
+
+            lens[i] = (e & LengthTable::SLOW) ? 0 : len;
+        }
+
+        while (offset < base + blockSize) {
+            starts.push_back((uint32_t)offset);
+
+            const uint8_t len = lens[offset - base];
+            offset += len ? len : getOPLen(decode + offset, size - offset);
+        }
+    }
+
+    while (offset < size) {
+        starts.push_back((uint32_t)offset);
+        offset += getOPLen(decode + offset, size - offset);
+    }
+
+    return starts;
+}
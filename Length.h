@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Length of the instruction at cDecode as decodeOP sees it, without
+// decoding operands (rem > 0)
+size_t getOPLen(const uint8_t *cDecode, size_t rem);
+
+// Offsets of every instruction the linear sweep over decode[0, size)
+// visits, in order
+std::vector<uint32_t> getBoundaries(const uint8_t *decode, size_t size);
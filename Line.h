@@ -0,0 +1,144 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+enum NumType { DEC, UDEC, HEX1_NO_DECORATION, HEX1, HEX2, HEX4 };
+
+struct Num {
+    uint32_t val;
+    enum NumType type;
+};
+
+struct Pad {
+    size_t i;
+};
+
+// Two hex digits per byte value, "000102...FEFF"
+struct HexPairs {
+    char pairs[512];
+
+    constexpr HexPairs() : pairs() {
+        const char digits[] = "0123456789ABCDEF";
+
+        for (size_t i = 0; i < 256; i++) {
+            pairs[i * 2] = digits[i >> 4];
+            pairs[i * 2 + 1] = digits[i & 0xF];
+        }
+    }
+};
+
+// Note there is no zero termination required
+class Line {
+  public:
+    char text[256];
+    size_t len;
+
+    Line &operator<<(const char *str) { return append(str, strlen(str)); }
+
+    Line &append(const char *str, size_t strSize) {
+        const size_t toAdd = std::min(strSize, sizeof(text) - len);
+
+        memcpy(text + len, str, toAdd);
+        len += toAdd;
+
+        return *this;
+    }
+
+    Line &operator<<(Pad pad) {
+        if (pad.i > len && pad.i < sizeof(text)) {
+            memset(text + len, ' ', pad.i - len);
+            len = pad.i;
+        }
+
+        return *this;
+    }
+
+    // Same text as printf with %d, %u, %02X, 0x%02X, 0x%04X and 0x%08X
+    Line &operator<<(Num num) {
+        if (sizeof(text) - len >= maxNumLen) {
+            len += format(num, text + len);
+            return *this;
+        }
+
+        char str[maxNumLen];
+        return append(str, format(num, str));
+    }
+
+  private:
+    // "-2147483648"
+    static const size_t maxNumLen = 11;
+
+    static constexpr HexPairs hex{};
+
+    // At least width digits, more if val needs them
+    static size_t putHex(char *out, uint32_t val, size_t width) {
+        const size_t digits = val ? (32 - __builtin_clz(val) + 3) / 4 : 1;
+        const size_t n = std::max(digits, width);
+
+        char *p = out + n;
+
+        for (; p - out >= 2; val >>= 8) {
+            p -= 2;
+            memcpy(p, hex.pairs + (val & 0xFF) * 2, 2);
+        }
+
+        if (p != out) {
+            *out = hex.pairs[(val & 0xF) * 2 + 1];
+        }
+
+        return n;
+    }
+
+    static size_t putDec(char *out, uint32_t mag, bool negative) {
+        char rev[maxNumLen];
+        size_t n = 0;
+
+        do {
+            rev[n++] = (char)('0' + mag % 10);
+            mag /= 10;
+        } while (mag);
+
+        size_t i = 0;
+
+        if (negative) {
+            out[i++] = '-';
+        }
+
+        while (n) {
+            out[i++] = rev[--n];
+        }
+
+        return i;
+    }
+
+    static size_t format(Num num, char *out) {
+        switch (num.type) {
+        case DEC:
+            // Negate as unsigned, INT32_MIN has no positive counterpart
+            if ((int32_t)num.val < 0) {
+                return putDec(out, 0u - num.val, true);
+            }
+
+            return putDec(out, num.val, false);
+        case UDEC:
+            return putDec(out, num.val, false);
+        case HEX1_NO_DECORATION:
+            return putHex(out, num.val, 2);
+        case HEX1:
+            memcpy(out, "0x", 2);
+            return 2 + putHex(out + 2, num.val, 2);
+        case HEX2:
+            memcpy(out, "0x", 2);
+            return 2 + putHex(out + 2, num.val, 4);
+        case HEX4:
+            memcpy(out, "0x", 2);
+            return 2 + putHex(out + 2, num.val, 8);
+        }
+
+        return 0;
+    }
+};
@@ -0,0 +1,150 @@
+#include "Output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Line.h"
+#include "Probe.h"
+#include "Record.h"
+#include "XRef.h"
+
+static const size_t bufferSize = 1 << 20;
+
+Output::Output(int fd, bool buffered, OutputMode mode)
+    : fd(fd), buffered(buffered), mode(mode), xrefs(nullptr), sink(nullptr),
+      len(0) {
+    if (buffered) {
+        buf.resize(bufferSize);
+    }
+}
+
+Output::Output(std::vector<char> &sink, OutputMode mode)
+    : fd(-1), buffered(true), mode(mode), xrefs(nullptr), sink(&sink),
+      len(0) {
+    buf.resize(bufferSize);
+}
+
+Output::~Output() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void Output::put(const char *data, size_t dataLen) {
+    if (!buffered) {
+        PROBE_TIME(Probe::OUTPUT_CALLS, Probe::OUTPUT_NS);
+        fwrite(data, 1, dataLen, stdout);
+        return;
+    }
+
+    if (buf.size() - len < dataLen) {
+        flush();
+
+        // Large blocks go out directly instead of through the buffer
+        if (buf.size() < dataLen) {
+            writeAll(data, dataLen);
+            return;
+        }
+    }
+
+    memcpy(buf.data() + len, data, dataLen);
+    len += dataLen;
+}
+
+void Output::put(const Line &line) {
+    if (!buffered) {
+        PROBE_TIME(Probe::OUTPUT_CALLS, Probe::OUTPUT_NS);
+        printf("%.*s\n", (int)line.len, line.text);
+        return;
+    }
+
+    // Lines are small compared to the buffer, so only check once
+    if (buf.size() - len < line.len + 1) {
+        flush();
+    }
+
+    memcpy(buf.data() + len, line.text, line.len);
+    len += line.len;
+    buf[len++] = '\n';
+}
+
+void Output::render(const Instruction &insn, const uint8_t *cDecode,
+                    std::vector<char> &text) const {
+    Line line{};
+    printRecord(mode, insn, cDecode, line, xrefs);
+    text.insert(text.end(), line.text, line.text + line.len);
+
+    if (mode == OutputMode::JSON && xrefs) {
+        printJSONXRefs(insn.address, insn.len, *xrefs, text);
+    }
+}
+
+void Output::put(const Instruction &insn, const uint8_t *cDecode) {
+    if (mode == OutputMode::JSON && xrefs) {
+        std::vector<char> text;
+        render(insn, cDecode, text);
+        put(text.data(), text.size());
+        return;
+    }
+
+    Line line{};
+    printRecord(mode, insn, cDecode, line, xrefs);
+    put(line.text, line.len);
+}
+
+void Output::putData(uint32_t address, const uint8_t *cDecode,
+                     size_t dataLen) {
+    Line line{};
+    printDataRecord(mode, address, cDecode, dataLen, line, xrefs);
+
+    if (mode == OutputMode::JSON && xrefs) {
+        std::vector<char> text(line.text, line.text + line.len);
+        printJSONXRefs(address, dataLen, *xrefs, text);
+        put(text.data(), text.size());
+        return;
+    }
+
+    put(line.text, line.len);
+}
+
+void Output::writeAll(const char *data, size_t dataLen) {
+    if (sink) {
+        sink->insert(sink->end(), data, data + dataLen);
+        return;
+    }
+
+    PROBE_TIME(Probe::OUTPUT_CALLS, Probe::OUTPUT_NS);
+    size_t written = 0;
+
+    while (written < dataLen) {
+        const ssize_t res = write(fd, data + written, dataLen - written);
+
+        if (res == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            fprintf(stderr, "Cannot write output\n");
+            throw -1;
+        }
+
+        written += res;
+    }
+}
+
+void Output::flush() {
+    if (!buffered) {
+        fflush(stdout);
+        return;
+    }
+
+    const size_t toWrite = len;
+    len = 0;
+    writeAll(buf.data(), toWrite);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Line.h"
+#include "Record.h"
+
+class XRefIndex;
+
+// Where the disassembly goes. Buffered output collects lines in one large
+// buffer and hands it to write() when full, unbuffered output is one printf
+// per line, which is what you want on a terminal. Instructions are written
+// as records of the output mode, annotated with their references if an
+// index is set.
+class Output {
+  public:
+    Output(int fd, bool buffered, OutputMode mode = OutputMode::TEXT);
+
+    // Buffered output appended to sink instead of written to a descriptor
+    Output(std::vector<char> &sink, OutputMode mode);
+    ~Output();
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+    void put(const char *data, size_t len);
+    void put(const Line &line);
+    void put(const Instruction &insn, const uint8_t *cDecode);
+    void putData(uint32_t address, const uint8_t *cDecode, size_t dataLen);
+    void flush();
+
+    // Appends the record put(insn, cDecode) writes, safe to call from any
+    // thread
+    void render(const Instruction &insn, const uint8_t *cDecode,
+                std::vector<char> &text) const;
+
+    void setXRefs(const XRefIndex *index) { xrefs = index; }
+    OutputMode getMode() const { return mode; }
+
+  private:
+    void writeAll(const char *data, size_t len);
+
+    int fd;
+    bool buffered;
+    OutputMode mode;
+    const XRefIndex *xrefs;
+    std::vector<char> *sink;
+    std::vector<char> buf;
+    size_t len;
+};
@@ -0,0 +1,231 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Decoder.h"
+#include "Line.h"
+#include "Output.h"
+#include "Probe.h"
+
+struct Chunk {
+    size_t begin;
+    size_t end;
+
+    // Offsets of the speculatively decoded instructions relative to begin,
+    // which fit 32 bits for any image size, and where their records start
+    // in text. The last one ends at exit, which is >= end.
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> lines;
+
+    // Status of each instruction in starts, only kept for the probes
+    std::vector<uint8_t> statuses;
+    std::vector<char> text;
+    size_t exit;
+
+    bool done;
+};
+
+// Decodes [offset, end) into text, stops early at the first offset for which
+// stop returns true. Returns the offset it stopped at. Without statuses the
+// instructions are counted as listed right away.
+template <typename F>
+static size_t decodeRange(const uint8_t *decode, size_t size, size_t offset,
+                          size_t end, uint32_t execOffset, const Output &out,
+                          std::vector<char> &text,
+                          std::vector<uint8_t> *statuses, F stop) {
+    while (offset < end && !stop(offset)) {
+        const uint8_t *cDecode = decode + offset;
+
+        Instruction insn;
+        decodeOP(cDecode, size - offset, execOffset + offset, insn);
+
+        if (probesEnabled && statuses) {
+            statuses->push_back((uint8_t)insn.status);
+        } else {
+            PROBE_STATUS(insn.status, insn.len);
+        }
+
+        out.render(insn, cDecode, text);
+
+        offset += insn.len;
+    }
+
+    return offset;
+}
+
+static void decodeChunk(const uint8_t *decode, size_t size,
+                        uint32_t execOffset, const Output &out,
+                        Chunk &chunk) {
+    // Lines are usually well below 64 characters
+    chunk.text.reserve((chunk.end - chunk.begin) * 24);
+
+    chunk.exit = decodeRange(decode, size, chunk.begin, chunk.end, execOffset,
+                             out, chunk.text, &chunk.statuses,
+                             [&](size_t offset) {
+                                 chunk.starts.push_back(
+                                     (uint32_t)(offset - chunk.begin));
+                                 chunk.lines.push_back(chunk.text.size());
+                                 return false;
+                             });
+}
+
+// Emits the chunk as the serial sweep would see it when it enters at entry,
+// returns where the serial sweep leaves the chunk
+static size_t emitChunk(const uint8_t *decode, size_t size,
+                        uint32_t execOffset, const Chunk &chunk, size_t entry,
+                        Output &out) {
+    // The serial sweep never enters before begin
+    const size_t begin = chunk.begin;
+    auto it = std::lower_bound(chunk.starts.begin(), chunk.starts.end(),
+                               entry - begin);
+
+    if (it == chunk.starts.end() || begin + *it != entry) {
+        std::vector<char> fixup;
+
+        entry = decodeRange(decode, size, entry, chunk.end, execOffset,
+                            out, fixup, nullptr, [&](size_t offset) {
+                                while (it != chunk.starts.end() &&
+                                       begin + *it < offset) {
+                                    it++;
+                                }
+
+                                return it != chunk.starts.end() &&
+                                       begin + *it == offset;
+                            });
+
+        out.put(fixup.data(), fixup.size());
+
+        if (entry >= chunk.end) {
+            return entry;
+        }
+    }
+
+    const size_t first = it - chunk.starts.begin();
+
+#ifdef DMASK_PROBES
+    for (size_t i = first; i < chunk.starts.size(); i++) {
+        const size_t next = i + 1 < chunk.starts.size()
+                                ? begin + chunk.starts[i + 1]
+                                : chunk.exit;
+        PROBE_STATUS(chunk.statuses[i], next - (begin + chunk.starts[i]));
+    }
+#endif
+
+    const size_t line = chunk.lines[first];
+    out.put(chunk.text.data() + line, chunk.text.size() - line);
+
+    return chunk.exit;
+}
+
+void decParallel(const uint8_t *decode, size_t size, uint32_t execOffset,
+                 size_t threads, Output &out) {
+    threads = std::max<size_t>(threads, 1);
+
+    const size_t chunkSize =
+        std::clamp<size_t>(size / (threads * 8), 4096, 1 << 20);
+    const size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+    std::vector<Chunk> chunks(chunkCount);
+
+    for (size_t i = 0; i < chunkCount; i++) {
+        chunks[i].begin = i * chunkSize;
+        chunks[i].end = std::min(size, (i + 1) * chunkSize);
+        chunks[i].done = false;
+    }
+
+    // Workers may only run this far ahead of the writer, which bounds the
+    // amount of formatted text held in memory
+    const size_t window = threads * 4;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    size_t next = 0;
+    size_t emitted = 0;
+    bool failed = false;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t i;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() {
+                    return failed || next >= chunkCount ||
+                           next < emitted + window;
+                });
+
+                if (failed || next >= chunkCount) {
+                    return;
+                }
+
+                i = next++;
+            }
+
+            decodeChunk(decode, size, execOffset, out, chunks[i]);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks[i].done = true;
+            }
+
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    size_t entry = 0;
+
+    try {
+        for (size_t i = 0; i < chunkCount; i++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return chunks[i].done; });
+            }
+
+            entry = emitChunk(decode, size, execOffset, chunks[i], entry, out);
+
+            // Done with it, give the memory back
+            std::vector<char>().swap(chunks[i].text);
+            std::vector<uint32_t>().swap(chunks[i].starts);
+            std::vector<uint32_t>().swap(chunks[i].lines);
+            std::vector<uint8_t>().swap(chunks[i].statuses);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                emitted = i + 1;
+            }
+
+            cond.notify_all();
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+        }
+
+        cond.notify_all();
+
+        for (std::thread &t : workers) {
+            t.join();
+        }
+
+        throw;
+    }
+
+    for (std::thread &t : workers) {
+        t.join();
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Output.h"
+
+// Same output as the serial sweep, but the image is cut into chunks which
+// are decoded and formatted on threads workers. Every chunk is decoded
+// speculatively from its first byte; when the stream of the previous chunk
+// enters it somewhere else, it is re-decoded from there until it runs into
+// one of the speculative instruction starts.
+void decParallel(const uint8_t *decode, size_t size, uint32_t execOffset,
+                 size_t threads, Output &out);
@@ -0,0 +1,126 @@
+#include "Patch.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Length.h"
+
+// Matching an opcode may look at up to 3 bytes even when fewer are used,
+// e.g. for DB
+static const size_t minSpan = 3;
+
+static const size_t pageSize = (size_t)1 << BoundaryIndex::pageBits;
+static const size_t pageMask = pageSize - 1;
+
+BoundaryIndex::BoundaryIndex(const uint8_t *decode, size_t size)
+    : decode(decode), size(size), pages((size + pageSize - 1) / pageSize),
+      total(0) {
+    for (uint32_t start : getBoundaries(decode, size)) {
+        pages[start >> pageBits].push_back((uint16_t)(start & pageMask));
+        total++;
+    }
+}
+
+bool BoundaryIndex::isStart(size_t offset) const {
+    if (offset >= size) {
+        return false;
+    }
+
+    const std::vector<uint16_t> &page = pages[offset >> pageBits];
+    return std::binary_search(page.begin(), page.end(),
+                              (uint16_t)(offset & pageMask));
+}
+
+size_t BoundaryIndex::covering(size_t offset) const {
+    size_t p = offset >> pageBits;
+    const std::vector<uint16_t> &page = pages[p];
+
+    auto it = std::upper_bound(page.begin(), page.end(),
+                               (uint16_t)(offset & pageMask));
+
+    if (it != page.begin()) {
+        return (p << pageBits) + *(it - 1);
+    }
+
+    // Instructions are at most 6 bytes, the previous page has one
+    while (p > 0 && pages[--p].empty()) {
+    }
+
+    return pages[p].empty() ? 0 : (p << pageBits) + pages[p].back();
+}
+
+void BoundaryIndex::replace(size_t begin, size_t end,
+                            const std::vector<uint32_t> &starts) {
+    auto next = starts.begin();
+
+    for (size_t p = begin >> pageBits; p <= (end - 1) >> pageBits; p++) {
+        const size_t base = p << pageBits;
+        std::vector<uint16_t> &page = pages[p];
+
+        const uint16_t first = (uint16_t)(std::max(begin, base) - base);
+        const size_t last = std::min(end, base + pageSize) - base;
+
+        auto from = std::lower_bound(page.begin(), page.end(), first);
+        auto to = std::lower_bound(from, page.end(), last);
+
+        std::vector<uint16_t> added;
+
+        while (next != starts.end() && *next < base + pageSize) {
+            added.push_back((uint16_t)(*next - base));
+            next++;
+        }
+
+        total = total - (to - from) + added.size();
+
+        from = page.erase(from, to);
+        page.insert(from, added.begin(), added.end());
+    }
+}
+
+Change BoundaryIndex::update(size_t begin, size_t end) {
+    Change change;
+    change.begin = covering(begin);
+    change.removed = 0;
+
+    // Earlier instructions may have looked at the patched bytes while
+    // matching, without using them
+    while (change.begin > 0) {
+        const size_t prev = covering(change.begin - 1);
+
+        if (prev + std::max(change.begin - prev, minSpan) <= begin) {
+            break;
+        }
+
+        change.begin = prev;
+    }
+
+    size_t offset = change.begin;
+
+    // Past the patch, an old boundary starts the same instruction as before
+    while (offset < size && (offset < end || !isStart(offset))) {
+        change.starts.push_back((uint32_t)offset);
+        offset += getOPLen(decode + offset, size - offset);
+    }
+
+    change.end = std::min(offset, size);
+
+    for (size_t p = change.begin >> pageBits;
+         change.end > change.begin && p <= (change.end - 1) >> pageBits;
+         p++) {
+        const size_t base = p << pageBits;
+
+        for (uint16_t start : pages[p]) {
+            change.removed +=
+                base + start >= change.begin && base + start < change.end;
+        }
+    }
+
+    if (change.end > change.begin) {
+        replace(change.begin, change.end, change.starts);
+    }
+
+    return change;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// What a patch did to the linear sweep: the instructions in [begin, end)
+// were replaced by the ones starting at starts. Outside of that range the
+// listing is unchanged. Offsets are into the image.
+struct Change {
+    size_t begin;
+    size_t end;
+    size_t removed; // old instructions in [begin, end)
+    std::vector<uint32_t> starts;
+};
+
+// Instruction boundaries of the linear sweep over decode[0, size), kept up
+// to date while bytes are patched in place. The boundaries are stored per
+// page, so an update only touches the pages the changed instructions are in
+// and costs the same for any image size.
+class BoundaryIndex {
+  public:
+    static const size_t pageBits = 12;
+
+    // decode stays owned by the caller, who patches it and then calls update
+    BoundaryIndex(const uint8_t *decode, size_t size);
+
+    // Call after decode[begin, end) changed (begin < end <= size). Decodes
+    // again from the first instruction that looked at a changed byte, until
+    // the new instructions line up with the old ones after the patch.
+    Change update(size_t begin, size_t end);
+
+    bool isStart(size_t offset) const;
+
+    // Start of the instruction covering offset (< size)
+    size_t covering(size_t offset) const;
+
+    size_t count() const { return total; }
+
+  private:
+    void replace(size_t begin, size_t end,
+                 const std::vector<uint32_t> &starts);
+
+    const uint8_t *decode;
+    size_t size;
+
+    // Offsets within the page of the boundaries in each page
+    std::vector<std::vector<uint16_t>> pages;
+    size_t total;
+};
@@ -0,0 +1,66 @@
+#include "Probe.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef DMASK_PROBES
+std::atomic<uint64_t> probeCounts[(size_t)Probe::COUNT];
+thread_local bool probesPaused = false;
+#endif
+
+ProbeCounts getProbes() {
+    ProbeCounts probes{};
+
+#ifdef DMASK_PROBES
+    for (size_t i = 0; i < (size_t)Probe::COUNT; i++) {
+        probes.counts[i] = probeCounts[i].load(std::memory_order_relaxed);
+    }
+#endif
+
+    return probes;
+}
+
+void resetProbes() {
+#ifdef DMASK_PROBES
+    for (std::atomic<uint64_t> &count : probeCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+static void writeTime(FILE *file, const char *name, uint64_t calls,
+                      uint64_t ns) {
+    fprintf(file, "%-12s %14" PRIu64 " calls %10.3f ms %8.1f ns/call\n", name,
+            calls, ns / 1e6, calls ? (double)ns / calls : 0.0);
+}
+
+void writeProbes(FILE *file) {
+    const ProbeCounts p = getProbes();
+
+    const uint64_t calls = p[Probe::GETOP_CALLS];
+    fprintf(file,
+            "getOP        %14" PRIu64 " calls %10" PRIu64 " misses %6.2f "
+            "nodes/call\n",
+            calls, p[Probe::GETOP_MISSES],
+            calls ? (double)p[Probe::GETOP_STEPS] / calls : 0.0);
+
+    writeTime(file, "decode", p[Probe::DECODE_CALLS], p[Probe::DECODE_NS]);
+    writeTime(file, "format", p[Probe::FORMAT_CALLS], p[Probe::FORMAT_NS]);
+    writeTime(file, " operands", p[Probe::DESCRIPTION_CALLS],
+              p[Probe::DESCRIPTION_NS]);
+    writeTime(file, "output", p[Probe::OUTPUT_CALLS], p[Probe::OUTPUT_NS]);
+
+    const uint64_t bytes = p[Probe::OP_BYTES] + p[Probe::TRUNCATED_BYTES] +
+                           p[Probe::FPU_RESERVED_BYTES] + p[Probe::DB_BYTES];
+    const Probe statuses[] = {Probe::OP_BYTES, Probe::TRUNCATED_BYTES,
+                              Probe::FPU_RESERVED_BYTES, Probe::DB_BYTES};
+    const char *names[] = {"OP", "TRUNCATED", "FPU RESERVED", "DB"};
+
+    for (size_t i = 0; i < 4; i++) {
+        const uint64_t n = p[statuses[i]];
+        fprintf(file, "%-12s %14" PRIu64 " bytes %9.2f %%\n", names[i], n,
+                bytes ? 100.0 * n / bytes : 0.0);
+    }
+}
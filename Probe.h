@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef DMASK_PROBES
+#include <atomic>
+#include <chrono>
+#endif
+
+// Counters on the hot paths, compiled in with -DDMASK_PROBES, e.g.
+// make CXXEXTFLAGS=-DDMASK_PROBES. Without it the PROBE_ macros expand to
+// nothing and getProbes returns zeros.
+
+#ifdef DMASK_PROBES
+static const bool probesEnabled = true;
+#else
+static const bool probesEnabled = false;
+#endif
+
+enum class Probe : uint8_t {
+    GETOP_CALLS,
+    GETOP_STEPS, // trie nodes visited
+    GETOP_MISSES,
+
+    // Bytes listed per Status by the sweeps (dec, decRange, decParallel and
+    // decRecursive), in the order of Status
+    OP_BYTES,
+    TRUNCATED_BYTES,
+    FPU_RESERVED_BYTES,
+    DB_BYTES,
+
+    // Calls and wall time: decodeOP from anywhere but the construction of
+    // tables, printRecord and printDataRecord, printDescription (also
+    // counted in format when called from there) and the writes of Output
+    DECODE_CALLS,
+    DECODE_NS,
+    FORMAT_CALLS,
+    FORMAT_NS,
+    DESCRIPTION_CALLS,
+    DESCRIPTION_NS,
+    OUTPUT_CALLS,
+    OUTPUT_NS,
+
+    COUNT
+};
+
+struct ProbeCounts {
+    uint64_t counts[(size_t)Probe::COUNT];
+
+    uint64_t operator[](Probe probe) const { return counts[(size_t)probe]; }
+};
+
+// Totals of all threads since the start or the last resetProbes
+ProbeCounts getProbes();
+void resetProbes();
+
+// getProbes as a table
+void writeProbes(FILE *file);
+
+#ifdef DMASK_PROBES
+extern std::atomic<uint64_t> probeCounts[(size_t)Probe::COUNT];
+
+// Set while a thread builds a table, which is not part of any measurement
+extern thread_local bool probesPaused;
+
+#define PROBE_ADD(probe, n)                                                    \
+    (probesPaused ? (void)0                                                    \
+                  : (void)probeCounts[(size_t)(probe)].fetch_add(              \
+                        (n), std::memory_order_relaxed))
+
+class ProbePause {
+  public:
+    ProbePause() : was(probesPaused) { probesPaused = true; }
+    ~ProbePause() { probesPaused = was; }
+
+  private:
+    bool was;
+};
+
+// Adds a call and the time until the end of the scope
+class ProbeTimer {
+  public:
+    ProbeTimer(Probe calls, Probe ns)
+        : calls(calls), ns(ns), start(std::chrono::steady_clock::now()) {}
+
+    ~ProbeTimer() {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        PROBE_ADD(calls, 1);
+        PROBE_ADD(ns, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          elapsed)
+                          .count());
+    }
+
+  private:
+    Probe calls;
+    Probe ns;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROBE_TIME(calls, ns) const ProbeTimer probeTimer(calls, ns)
+#define PROBE_PAUSE() const ProbePause probePause
+#else
+#define PROBE_ADD(probe, n) ((void)0)
+#define PROBE_TIME(calls, ns) ((void)0)
+#define PROBE_PAUSE() ((void)0)
+#endif
+
+// Adds n bytes of an instruction with the given Status
+#define PROBE_STATUS(status, n)                                                \
+    PROBE_ADD((Probe)((size_t)Probe::OP_BYTES + (size_t)(status)), (n))
@@ -0,0 +1,199 @@
+#include "Record.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+#include "Probe.h"
+#include "XRef.h"
+
+static const char *statusNames[] = {"op", "truncated", "fpu_reserved", "db",
+                                    "data"};
+
+static void putBinary(const Instruction &insn, const uint8_t *cDecode,
+                      Line &line) {
+    Record record{};
+    record.address = insn.address;
+    record.len = insn.len;
+    record.status = (uint8_t)insn.status;
+    memcpy(record.bytes, cDecode, insn.len);
+
+    if (insn.status == Status::OP) {
+        strncpy(record.mnemonic, insn.op->name, sizeof(record.mnemonic) - 1);
+
+        for (size_t i = 0; i < 3; i++) {
+            record.types[i] = (uint8_t)insn.operands[i].type;
+            record.vals[i] = insn.operands[i].val;
+        }
+    }
+
+    if (insn.hasModRM) {
+        record.modrm = (uint8_t)((uint8_t)insn.mod << 6 | insn.reg << 3 |
+                                 insn.rm);
+        record.flags |= flagModRM;
+    }
+
+    if (insn.dispWidth == Width::BYTE) {
+        record.flags |= flagDisp8;
+    } else if (insn.dispWidth == Width::WORD) {
+        record.flags |= flagDisp16;
+    }
+
+    record.disp = insn.disp;
+
+    line.append((const char *)&record, sizeof(record));
+}
+
+// Column of the reference list in the listing
+static const size_t xrefColumn = 80;
+
+// Leaves room for one more reference and the ellipsis
+static const size_t xrefRoom = 40;
+
+static void putTextXRefs(uint32_t address, size_t len,
+                         const XRefIndex *xrefs, Line &line) {
+    if (!xrefs) {
+        return;
+    }
+
+    const auto refs = xrefs->find(address, (uint64_t)address + len);
+
+    for (const XRef *ref = refs.first; ref != refs.second; ref++) {
+        if (ref != refs.first && sizeof(line.text) - line.len < xrefRoom) {
+            line << ", ...";
+            break;
+        }
+
+        if (ref == refs.first) {
+            line << " " << Pad{xrefColumn} << "; <- ";
+        } else {
+            line << ", ";
+        }
+
+        line << Num{ref->from, HEX4} << " " << getRefKindName(ref->kind);
+
+        // Into the middle of the instruction
+        if (ref->target != address) {
+            line << " +" << Num{ref->target - address, DEC};
+        }
+    }
+}
+
+// The fields every JSON object starts with
+static void putJSONHead(uint32_t address, const uint8_t *cDecode, size_t len,
+                        uint8_t status, Line &line) {
+    line << "{\"address\":" << Num{address, UDEC} << ",\"bytes\":\"";
+
+    for (size_t i = 0; i < len; i++) {
+        line << Num{cDecode[i], HEX1_NO_DECORATION};
+    }
+
+    line << "\",\"status\":\"" << statusNames[status] << "\"";
+}
+
+// Operand text never needs escaping, it is registers, numbers and brackets
+static void putJSON(const Instruction &insn, const uint8_t *cDecode,
+                    const XRefIndex *xrefs, Line &line) {
+    putJSONHead(insn.address, cDecode, insn.len, (uint8_t)insn.status, line);
+
+    if (insn.status == Status::OP) {
+        line << ",\"mnemonic\":\"" << insn.op->name << "\",\"operands\":[";
+
+        bool first = true;
+
+        for (const Operand &operand : insn.operands) {
+            if (operand.type == Type::NONE) {
+                continue;
+            }
+
+            line << (first ? "\"" : ",\"");
+            printOperand(insn, operand, line);
+            line << "\"";
+
+            first = false;
+        }
+
+        line << "]";
+    }
+
+    // Left open for printJSONXRefs
+    if (!xrefs) {
+        line << "}\n";
+    }
+}
+
+void printRecord(OutputMode mode, const Instruction &insn,
+                 const uint8_t *cDecode, Line &line, const XRefIndex *xrefs) {
+    PROBE_TIME(Probe::FORMAT_CALLS, Probe::FORMAT_NS);
+
+    switch (mode) {
+    case OutputMode::TEXT:
+        printOP(insn, cDecode, line);
+        putTextXRefs(insn.address, insn.len, xrefs, line);
+        line << "\n";
+        break;
+    case OutputMode::BINARY:
+        putBinary(insn, cDecode, line);
+        break;
+    case OutputMode::JSON:
+        putJSON(insn, cDecode, xrefs, line);
+        break;
+    }
+}
+
+void printDataRecord(OutputMode mode, uint32_t address, const uint8_t *cDecode,
+                     size_t len, Line &line, const XRefIndex *xrefs) {
+    PROBE_TIME(Probe::FORMAT_CALLS, Probe::FORMAT_NS);
+
+    switch (mode) {
+    case OutputMode::TEXT:
+        printData(address, cDecode, len, line);
+        putTextXRefs(address, len, xrefs, line);
+        line << "\n";
+        break;
+    case OutputMode::BINARY: {
+        Record record{};
+        record.address = address;
+        record.len = (uint8_t)len;
+        record.status = statusData;
+        memcpy(record.bytes, cDecode, len);
+
+        line.append((const char *)&record, sizeof(record));
+        break;
+    }
+    case OutputMode::JSON:
+        putJSONHead(address, cDecode, len, statusData, line);
+
+        if (!xrefs) {
+            line << "}\n";
+        }
+        break;
+    }
+}
+
+void printJSONXRefs(uint32_t address, size_t len, const XRefIndex &xrefs,
+                    std::vector<char> &text) {
+    const auto refs = xrefs.find(address, (uint64_t)address + len);
+
+    Line line{};
+    line << ",\"xrefs\":[";
+
+    for (const XRef *ref = refs.first; ref != refs.second; ref++) {
+        line << (ref == refs.first ? "{" : ",{") << "\"from\":"
+             << Num{ref->from, UDEC} << ",\"target\":"
+             << Num{ref->target, UDEC} << ",\"kind\":\""
+             << getRefKindName(ref->kind) << "\"}";
+
+        // One reference is far shorter than a Line
+        text.insert(text.end(), line.text, line.text + line.len);
+        line.len = 0;
+    }
+
+    line << "]}\n";
+    text.insert(text.end(), line.text, line.text + line.len);
+}
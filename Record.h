@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Line.h"
+
+class XRefIndex;
+
+// What the disassembly is written as
+enum class OutputMode : uint8_t {
+    TEXT,   // the listing, one line per instruction
+    BINARY, // one Record per instruction
+    JSON    // JSON Lines, one object per instruction
+};
+
+// Record::status of data printed by the recursive traversal
+static const uint8_t statusData = 4;
+
+// Record::flags
+static const uint8_t flagModRM = 1;
+static const uint8_t flagDisp8 = 2;
+static const uint8_t flagDisp16 = 4;
+
+// Fixed size record of the binary output, host byte order. The output is a
+// plain array of these, record i is at i * sizeof(Record).
+struct Record {
+    uint32_t address;
+    uint32_t vals[3];  // Operand::val
+    uint16_t disp;     // displacement if flagDisp8 or flagDisp16
+    uint8_t len;       // bytes used from bytes
+    uint8_t status;    // Status, or statusData
+    uint8_t modrm;     // ModRM byte if flagModRM
+    uint8_t flags;
+    uint8_t types[3];  // Type of the operands, NONE for unused ones
+    uint8_t reserved;
+    uint8_t bytes[6];
+    char mnemonic[16]; // zero padded, empty unless status is Status::OP
+};
+
+static_assert(sizeof(Record) == 48, "Record layout changed");
+
+// Formats insn as one complete record of the given mode, including the line
+// break of the text modes. cDecode points to the insn.len bytes it was
+// decoded from. With xrefs, the text records list the references into the
+// instruction's bytes and JSON records are left open for printJSONXRefs.
+void printRecord(OutputMode mode, const Instruction &insn,
+                 const uint8_t *cDecode, Line &line,
+                 const XRefIndex *xrefs = nullptr);
+
+// Same for up to 4 bytes of data
+void printDataRecord(OutputMode mode, uint32_t address, const uint8_t *cDecode,
+                     size_t len, Line &line, const XRefIndex *xrefs = nullptr);
+
+// Ends a JSON record printed with xrefs by the array of every reference into
+// [address, address + len), which can be longer than a Line
+void printJSONXRefs(uint32_t address, size_t len, const XRefIndex &xrefs,
+                    std::vector<char> &text);
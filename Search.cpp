@@ -0,0 +1,254 @@
+#include "Search.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+#include "Output.h"
+#include "Record.h"
+
+static bool sameChar(char a, char b) {
+    return toupper((unsigned char)a) == toupper((unsigned char)b);
+}
+
+// Whole string glob match, '*' backtracks to the last star only
+static bool glob(const char *pattern, const char *str, size_t len) {
+    const char *star = nullptr;
+    size_t starPos = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (*pattern == '*') {
+            star = pattern++;
+            starPos = i;
+        } else if (*pattern == '?' ||
+                   (*pattern && sameChar(*pattern, str[i]))) {
+            pattern++;
+            i++;
+        } else if (star) {
+            pattern = star + 1;
+            i = ++starPos;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        pattern++;
+    }
+
+    return *pattern == '\0';
+}
+
+// Whether some instruction text starting with the mnemonic name can match.
+// Only rejects what can never match, the operands are not known yet.
+static bool mayMatch(const char *pattern, const char *name,
+                     bool mnemonicOnly) {
+    if (mnemonicOnly) {
+        return glob(pattern, name, strlen(name));
+    }
+
+    for (; *name; name++, pattern++) {
+        if (*pattern == '*') {
+            return true;
+        }
+
+        if (*pattern != '?' && !sameChar(*pattern, *name)) {
+            return false;
+        }
+    }
+
+    return *pattern == '\0' || *pattern == ' ' || *pattern == '*' ||
+           *pattern == '?';
+}
+
+// Single spaces between words, ", " between operands
+static std::string normalize(const std::string &text) {
+    std::string res;
+
+    for (char c : text) {
+        if (isspace((unsigned char)c)) {
+            if (!res.empty() && res.back() != ' ') {
+                res.push_back(' ');
+            }
+        } else if (c == ',') {
+            if (!res.empty() && res.back() == ' ') {
+                res.pop_back();
+            }
+
+            res += ", ";
+        } else {
+            res.push_back(c);
+        }
+    }
+
+    while (!res.empty() && res.back() == ' ') {
+        res.pop_back();
+    }
+
+    return res;
+}
+
+Pattern::Pattern(const char *text) : first(), firstCount(0), firstByte(0) {
+    const char *begin = text;
+
+    for (;;) {
+        const char *end = strchr(begin, ';');
+        const std::string item =
+            normalize(end ? std::string(begin, end) : std::string(begin));
+
+        if (item.empty()) {
+            printf("Empty instruction in search pattern\n");
+            throw -1;
+        }
+
+        items.push_back({item, item.find(' ') == std::string::npos});
+
+        if (!end) {
+            break;
+        }
+
+        begin = end + 1;
+    }
+
+    for (size_t i = 0; i < opsCount; i++) {
+        const Op &op = ops[i];
+
+        if (mayMatch(items[0].text.c_str(), op.name, items[0].mnemonicOnly)) {
+            first[op.code[0]] = true;
+        }
+    }
+
+    for (size_t b = 0; b < 256; b++) {
+        if (first[b]) {
+            firstCount++;
+            firstByte = (uint8_t)b;
+        }
+    }
+}
+
+bool Pattern::matchItem(const Item &item, const Instruction &insn) const {
+    if (insn.status != Status::OP) {
+        return false;
+    }
+
+    if (item.mnemonicOnly) {
+        return glob(item.text.c_str(), insn.op->name, strlen(insn.op->name));
+    }
+
+    // The operands are only formatted once the mnemonic fits
+    if (!mayMatch(item.text.c_str(), insn.op->name, false)) {
+        return false;
+    }
+
+    Line line{};
+    line << insn.op->name;
+    printDescription(insn, line);
+
+    return glob(item.text.c_str(), line.text, line.len);
+}
+
+size_t Pattern::match(const uint8_t *decode, size_t size, size_t offset,
+                      uint32_t execOffset) const {
+    const size_t begin = offset;
+
+    for (const Item &item : items) {
+        if (offset >= size) {
+            return 0;
+        }
+
+        Instruction insn;
+        decodeOP(decode + offset, size - offset, execOffset + offset, insn);
+
+        if (!matchItem(item, insn)) {
+            return 0;
+        }
+
+        offset += insn.len;
+    }
+
+    return offset - begin;
+}
+
+std::vector<Pattern::Match> Pattern::find(const uint8_t *decode, size_t size,
+                                          uint32_t execOffset) const {
+    std::vector<Match> found;
+
+    if (firstCount == 0) {
+        return found;
+    }
+
+    size_t offset = 0;
+
+    while (offset < size) {
+        // Skip to the next byte that can start a match
+        if (firstCount == 1) {
+            const void *next =
+                memchr(decode + offset, firstByte, size - offset);
+
+            if (!next) {
+                break;
+            }
+
+            offset = (const uint8_t *)next - decode;
+        } else {
+            while (offset < size && !first[decode[offset]]) {
+                offset++;
+            }
+
+            if (offset == size) {
+                break;
+            }
+        }
+
+        const size_t len = match(decode, size, offset, execOffset);
+
+        if (len) {
+            found.push_back({(uint32_t)offset, (uint32_t)len});
+            offset += len;
+        } else {
+            offset++;
+        }
+    }
+
+    return found;
+}
+
+void decSearch(const Pattern &pattern, const uint8_t *decode, size_t size,
+               uint32_t execOffset, Output &out) {
+    bool first = true;
+
+    for (const Pattern::Match &match :
+         pattern.find(decode, size, execOffset)) {
+        if (out.getMode() == OutputMode::TEXT && !first) {
+            out.put("; --\n", 5);
+        } else if (out.getMode() == OutputMode::JSON) {
+            Line line{};
+            line << "{\"match\":" << Num{execOffset + match.offset, UDEC}
+                 << "}\n";
+            out.put(line.text, line.len);
+        }
+
+        first = false;
+
+        const size_t end = match.offset + match.len;
+
+        for (size_t pos = match.offset; pos < end;) {
+            const uint8_t *cDecode = decode + pos;
+
+            Instruction insn;
+            decodeOP(cDecode, size - pos, execOffset + pos, insn);
+            out.put(insn, cDecode);
+
+            pos += insn.len;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "Decoder.h"
+#include "Output.h"
+
+// A sequence of instructions to look for, separated by ';'. Each one is
+// either a bare mnemonic, which matches it with any operands, or the
+// instruction as the listing prints it ("MOV AH, BYTE 0x09"). '*' matches
+// any text and '?' any single character, case does not matter. Examples:
+// "MOV AH, *; INT *0x21", "OUT *0x60, *", "J*; RET".
+class Pattern {
+  public:
+    struct Match {
+        uint32_t offset;
+        uint32_t len; // bytes of the matched instructions
+    };
+
+    explicit Pattern(const char *text);
+
+    // Places in decode[0, size) where the whole sequence decodes,
+    // instructions following each other. Every offset is tried, not only
+    // the boundaries of the linear sweep, but the search goes on after the
+    // end of each match, so matches do not overlap.
+    std::vector<Match> find(const uint8_t *decode, size_t size,
+                            uint32_t execOffset) const;
+
+    // Matches at offset, returns the length of the matched bytes or 0
+    size_t match(const uint8_t *decode, size_t size, size_t offset,
+                 uint32_t execOffset) const;
+
+  private:
+    struct Item {
+        std::string text;
+        bool mnemonicOnly;
+    };
+
+    bool matchItem(const Item &item, const Instruction &insn) const;
+
+    std::vector<Item> items;
+
+    // First opcode bytes that can start a match
+    bool first[256];
+    size_t firstCount;
+    uint8_t firstByte;
+};
+
+// Prints the instructions of every match. Text output separates the matches
+// by a "; --" line, JSON output starts each with a {"match":address} object.
+void decSearch(const Pattern &pattern, const uint8_t *decode, size_t size,
+               uint32_t execOffset, Output &out);
@@ -0,0 +1,49 @@
+#include "Seek.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Length.h"
+
+SyncIndex::SyncIndex(const uint8_t *decode, size_t size)
+    : decode(decode), size(size), frontier(0) {}
+
+void SyncIndex::extend(size_t offset) {
+    while (frontier < size && checkpoints.size() * interval <= offset) {
+        const size_t mark = checkpoints.size() * interval;
+
+        while (frontier < mark) {
+            frontier += getOPLen(decode + frontier, size - frontier);
+        }
+
+        checkpoints.push_back((uint32_t)frontier);
+    }
+}
+
+uint32_t SyncIndex::seek(uint32_t offset) {
+    extend(offset);
+
+    // An instruction straddling the interval start leaves the checkpoint
+    // behind offset, the one before it is not
+    size_t i = offset / interval;
+
+    if (checkpoints[i] > offset) {
+        i--;
+    }
+
+    size_t start = checkpoints[i];
+
+    for (;;) {
+        const size_t next = start + getOPLen(decode + start, size - start);
+
+        if (next > offset) {
+            return (uint32_t)start;
+        }
+
+        start = next;
+    }
+}
+
+uint32_t SyncIndex::prev(uint32_t offset) { return seek(offset - 1); }
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// Instruction boundaries of the linear sweep over decode[0, size), for
+// jumping into the middle of an image and scrolling in both directions.
+// Every interval bytes the index keeps the first boundary at or after that
+// point, so a lookup only re-sweeps one interval. Checkpoints are added
+// lazily up to the furthest offset asked for. Offsets are into the image.
+class SyncIndex {
+  public:
+    static const size_t interval = 4096;
+
+    SyncIndex(const uint8_t *decode, size_t size);
+
+    // Start of the instruction covering offset (< size)
+    uint32_t seek(uint32_t offset);
+
+    // Start of the instruction before the one at offset (0 < offset <= size)
+    uint32_t prev(uint32_t offset);
+
+  private:
+    void extend(size_t offset);
+
+    const uint8_t *decode;
+    size_t size;
+
+    std::vector<uint32_t> checkpoints;
+    size_t frontier;
+};
@@ -0,0 +1,195 @@
+#include "Stats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Decoder.h"
+#include "Line.h"
+#include "Output.h"
+
+static const char *statusNames[] = {"OP", "TRUNCATED", "FPU RESERVED",
+                                    "DB"};
+
+void collectStats(const uint8_t *decode, size_t size, Stats &stats) {
+    size_t offset = 0;
+
+    while (offset < size) {
+        const uint8_t *cDecode = decode + offset;
+        const size_t rem = size - offset;
+
+        // decodeOP without the operands, which only the formatter needs
+        const Op *op = getOP(cDecode, rem);
+        size_t len;
+        Status status;
+
+        if (op) {
+            len = op->codeSz +
+                  getLen(*(op->description), cDecode + op->codeSz);
+            status = Status::OP;
+
+            if (len > rem) {
+                len = 1;
+                status = Status::TRUNCATED;
+            } else {
+                stats.opCounts[op - ops]++;
+            }
+        } else {
+            Instruction insn;
+            len = decodeOP(cDecode, rem, 0, insn);
+            status = insn.status;
+        }
+
+        stats.statusInsns[(size_t)status]++;
+        stats.statusBytes[(size_t)status] += len;
+        stats.lengths[len]++;
+
+        offset += len;
+    }
+
+    stats.bytes += size;
+    stats.insns = 0;
+
+    for (uint64_t n : stats.statusInsns) {
+        stats.insns += n;
+    }
+}
+
+// count, then its share of total with two decimals
+static void putCount(Line &line, uint64_t count, uint64_t total) {
+    char num[48];
+    const uint64_t hundredths = total ? count * 10000 / total : 0;
+
+    snprintf(num, sizeof(num), "%12" PRIu64 " %3" PRIu64 ".%02" PRIu64 "%%",
+             count, hundredths / 100, hundredths % 100);
+    line << num;
+}
+
+void writeStats(const Stats &stats, Output &out) {
+    Line line{};
+    char num[24];
+
+    snprintf(num, sizeof(num), "%" PRIu64, stats.bytes);
+    line << "bytes" << Pad{16} << num;
+    out.put(line);
+
+    line.len = 0;
+    snprintf(num, sizeof(num), "%" PRIu64, stats.insns);
+    line << "instructions" << Pad{16} << num;
+    out.put(line);
+
+    line.len = 0;
+    line << "\nstatus" << Pad{15} << "instructions" << Pad{42} << "bytes";
+    out.put(line);
+
+    for (size_t s = 0; s < 4; s++) {
+        line.len = 0;
+        line << statusNames[s] << Pad{14};
+        putCount(line, stats.statusInsns[s], stats.insns);
+        putCount(line, stats.statusBytes[s], stats.bytes);
+        out.put(line);
+    }
+
+    line.len = 0;
+    line << "\nlength" << Pad{15} << "instructions";
+    out.put(line);
+
+    for (size_t len = 1; len <= maxOPLen; len++) {
+        line.len = 0;
+        line << Num{(uint32_t)len, UDEC} << Pad{14};
+        putCount(line, stats.lengths[len], stats.insns);
+        out.put(line);
+    }
+
+    // Several ops[] entries share a mnemonic
+    std::vector<std::pair<const char *, uint64_t>> mnemonics;
+
+    for (size_t i = 0; i < opsCount; i++) {
+        mnemonics.push_back({ops[i].name, stats.opCounts[i]});
+    }
+
+    std::sort(mnemonics.begin(), mnemonics.end(),
+              [](const std::pair<const char *, uint64_t> &a,
+                 const std::pair<const char *, uint64_t> &b) {
+                  return strcmp(a.first, b.first) < 0;
+              });
+
+    std::vector<std::pair<const char *, uint64_t>> merged;
+
+    for (const auto &m : mnemonics) {
+        if (!merged.empty() && strcmp(merged.back().first, m.first) == 0) {
+            merged.back().second += m.second;
+        } else {
+            merged.push_back(m);
+        }
+    }
+
+    std::stable_sort(merged.begin(), merged.end(),
+                     [](const std::pair<const char *, uint64_t> &a,
+                        const std::pair<const char *, uint64_t> &b) {
+                         return a.second > b.second;
+                     });
+
+    line.len = 0;
+    line << "\nmnemonic" << Pad{15} << "instructions";
+    out.put(line);
+
+    for (const auto &m : merged) {
+        if (m.second == 0) {
+            break;
+        }
+
+        line.len = 0;
+        line << m.first << Pad{14};
+        putCount(line, m.second, stats.insns);
+        out.put(line);
+    }
+
+    std::vector<uint32_t> entries;
+
+    for (size_t i = 0; i < opsCount; i++) {
+        if (stats.opCounts[i]) {
+            entries.push_back((uint32_t)i);
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         return stats.opCounts[a] > stats.opCounts[b];
+                     });
+
+    line.len = 0;
+    line << "\nops[]" << Pad{9} << "opcode" << Pad{19} << "mnemonic"
+         << Pad{31} << "instructions";
+    out.put(line);
+
+    for (uint32_t i : entries) {
+        const Op &op = ops[i];
+
+        line.len = 0;
+        line << Num{i, UDEC} << Pad{8};
+
+        for (size_t b = 0; b < op.codeSz; b++) {
+            line << Num{op.code[b], HEX1_NO_DECORATION} << " ";
+        }
+
+        // The reg field of the ModRM byte, for FPU only with mod != 11 or
+        // mod == 11
+        if (op.opExt != OPExt::NONE) {
+            line << "/" << Num{op.n, UDEC};
+        }
+
+        if (op.opExt == OPExt::FPU_XY) {
+            line << "m";
+        } else if (op.opExt == OPExt::FPU_11) {
+            line << "r";
+        }
+
+        line << Pad{18} << op.name << Pad{30};
+        putCount(line, stats.opCounts[i], stats.insns);
+        out.put(line);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Output.h"
+
+// Counts of a linear sweep, without formatting a single instruction
+struct Stats {
+    uint64_t bytes = 0;
+    uint64_t insns = 0;
+
+    // Indexed by Status
+    uint64_t statusInsns[4]{};
+    uint64_t statusBytes[4]{};
+
+    // Instructions of each length, TRUNCATED and DB count as 1
+    uint64_t lengths[maxOPLen + 1]{};
+
+    // Matched instructions per entry of ops[]
+    std::vector<uint64_t> opCounts = std::vector<uint64_t>(opsCount);
+};
+
+// Adds the sweep over decode[0, size) to stats
+void collectStats(const uint8_t *decode, size_t size, Stats &stats);
+
+// Totals, the share of each status and length, then the counts per mnemonic
+// and per ops[] entry, most frequent first. Always text.
+void writeStats(const Stats &stats, Output &out);
@@ -0,0 +1,133 @@
+#include "Store.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Decoder.h"
+#include "Sweep.h"
+
+InstructionStore::InstructionStore(uint32_t execOffset)
+    : execOffset(execOffset) {
+    if (opsCount >= noOp) {
+        printf("Too many entries in ops[] for the store\n");
+        throw -1;
+    }
+}
+
+size_t InstructionStore::tailLen(size_t i) const {
+    return lens[i] - (opStatus[i] >> headShift);
+}
+
+size_t InstructionStore::tailStart(size_t i) const {
+    size_t start = blockTails[i >> blockBits];
+
+    for (size_t j = i & ~(((size_t)1 << blockBits) - 1); j < i; j++) {
+        start += tailLen(j);
+    }
+
+    return start;
+}
+
+void InstructionStore::add(const Instruction &insn, const uint8_t *cDecode) {
+    const uint32_t offset = insn.address - execOffset;
+
+    if (insn.address < execOffset ||
+        (!offsets.empty() && offset < offsets.back() + lens.back())) {
+        printf("Instructions must be added in address order\n");
+        throw -1;
+    }
+
+    if ((offsets.size() & (((size_t)1 << blockBits) - 1)) == 0) {
+        blockTails.push_back((uint32_t)tails.size());
+    }
+
+    const uint16_t index = insn.op ? (uint16_t)(insn.op - ops) : noOp;
+    size_t head = 0;
+
+    if (insn.status == Status::OP) {
+        head = insn.op->codeSz;
+    } else if (insn.status == Status::TRUNCATED) {
+        head = 1;
+    }
+
+    offsets.push_back(offset);
+    lens.push_back(insn.len);
+    opStatus.push_back((uint16_t)(head << headShift |
+                                  (size_t)insn.status << opBits | index));
+    tails.insert(tails.end(), cDecode + head, cDecode + insn.len);
+}
+
+void InstructionStore::shrink() {
+    offsets.shrink_to_fit();
+    lens.shrink_to_fit();
+    opStatus.shrink_to_fit();
+    tails.shrink_to_fit();
+    blockTails.shrink_to_fit();
+}
+
+const Op *InstructionStore::op(size_t i) const {
+    const uint16_t index = opStatus[i] & noOp;
+    return index == noOp ? nullptr : &ops[index];
+}
+
+size_t InstructionStore::find(uint32_t address) const {
+    if (address < execOffset) {
+        return size();
+    }
+
+    const uint32_t offset = address - execOffset;
+    auto it = std::upper_bound(offsets.begin(), offsets.end(), offset);
+
+    if (it == offsets.begin()) {
+        return size();
+    }
+
+    const size_t i = it - offsets.begin() - 1;
+    return offset < offsets[i] + lens[i] ? i : size();
+}
+
+void InstructionStore::bytes(size_t i, uint8_t *out) const {
+    const size_t head = opStatus[i] >> headShift;
+
+    if (head > 0) {
+        memcpy(out, op(i)->code, head);
+    }
+
+    memcpy(out + head, tails.data() + tailStart(i), lens[i] - head);
+}
+
+void InstructionStore::get(size_t i, Instruction &insn) const {
+    if (status(i) == Status::TRUNCATED) {
+        // The operands were cut off by the end of the image, which is gone
+        insn = Instruction{};
+        insn.address = address(i);
+        insn.op = op(i);
+        insn.status = Status::TRUNCATED;
+        insn.len = 1;
+        return;
+    }
+
+    uint8_t buf[maxOPLen];
+    bytes(i, buf);
+    decodeOP(buf, lens[i], address(i), insn);
+}
+
+size_t InstructionStore::memory() const {
+    return offsets.capacity() * sizeof(uint32_t) + lens.capacity() +
+           opStatus.capacity() * sizeof(uint16_t) + tails.capacity() +
+           blockTails.capacity() * sizeof(uint32_t);
+}
+
+void storeSweep(const uint8_t *decode, size_t size, uint32_t execOffset,
+                InstructionStore &store) {
+    SweepCursor cursor(decode, size, execOffset);
+
+    for (const Instruction &insn : cursor) {
+        store.add(insn, cursor.bytes(insn));
+    }
+}
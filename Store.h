@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+
+// Decoded instructions in parallel arrays, about 8 bytes each instead of the
+// 56 of an Instruction: the offset, the length, the entry of ops[] with the
+// status, and the bytes after the opcode, from which the operands are decoded
+// again on get. Filled in address order by add, e.g. from storeSweep, and
+// independent of the image afterwards.
+class InstructionStore {
+  public:
+    explicit InstructionStore(uint32_t execOffset = 0);
+
+    // insn was decoded from cDecode and starts after the last one added
+    void add(const Instruction &insn, const uint8_t *cDecode);
+
+    // Releases what the vectors reserved beyond their size
+    void shrink();
+
+    size_t size() const { return offsets.size(); }
+
+    uint32_t address(size_t i) const { return execOffset + offsets[i]; }
+    uint8_t length(size_t i) const { return lens[i]; }
+    Status status(size_t i) const {
+        return (Status)(opStatus[i] >> opBits & 0b11);
+    }
+
+    // nullptr for FPU_RESERVED and DB
+    const Op *op(size_t i) const;
+
+    // The instruction covering address, size() if there is none
+    size_t find(uint32_t address) const;
+
+    // Writes the length(i) bytes of the instruction to out
+    void bytes(size_t i, uint8_t *out) const;
+
+    // The instruction as decodeOP returned it
+    void get(size_t i, Instruction &insn) const;
+
+    // Bytes held by the arrays
+    size_t memory() const;
+
+  private:
+    static const size_t opBits = 12;
+    static const size_t headShift = opBits + 2;
+    static const uint16_t noOp = (1 << opBits) - 1;
+
+    // The position in tails is kept for every 2^blockBits-th instruction
+    static const size_t blockBits = 6;
+
+    size_t tailLen(size_t i) const;
+    size_t tailStart(size_t i) const;
+
+    uint32_t execOffset;
+
+    std::vector<uint32_t> offsets;
+    std::vector<uint8_t> lens;
+
+    // Index into ops[] (noOp if none) in the low bits, then Status, then
+    // the number of leading bytes which are opcode bytes of ops[] and not
+    // kept in tails
+    std::vector<uint16_t> opStatus;
+
+    // Bytes following the opcode bytes of ops[]: ModRM, displacement and
+    // immediates. All bytes for FPU_RESERVED and DB.
+    std::vector<uint8_t> tails;
+    std::vector<uint32_t> blockTails;
+};
+
+// Adds the sweep over decode[0, size), loaded at execOffset, to store
+void storeSweep(const uint8_t *decode, size_t size, uint32_t execOffset,
+                InstructionStore &store);
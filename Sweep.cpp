@@ -0,0 +1,35 @@
+#include "Sweep.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Decoder.h"
+#include "Output.h"
+#include "Probe.h"
+
+void dec(const uint8_t *decode, size_t size, uint32_t execOffset, Output &out) {
+    decRange(decode, size, 0, size, execOffset, out);
+}
+
+bool SweepCursor::next(Instruction &insn) {
+    if (current >= size) {
+        return false;
+    }
+
+    decodeOP(decode + current, size - current,
+             (uint32_t)(execOffset + current), insn);
+    current += insn.len;
+
+    return true;
+}
+
+void decRange(const uint8_t *decode, size_t size, size_t begin, size_t end,
+              uint32_t execOffset, Output &out) {
+    SweepCursor cursor(decode, size, execOffset, begin);
+    Instruction insn;
+
+    while (cursor.offset() < end && cursor.next(insn)) {
+        PROBE_STATUS(insn.status, insn.len);
+        out.put(insn, cursor.bytes(insn));
+    }
+}
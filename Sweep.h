@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Decoder.h"
+#include "Output.h"
+
+// Linear sweep over decode[0, size) that decodes one instruction per call,
+// with the same fallbacks as dec. Holds no memory besides the image, which
+// stays owned by the caller, so it can be stopped, copied and resumed at
+// will. Also usable in a range-for, which advances the cursor itself:
+//
+//     for (const Instruction &insn : cursor) {
+//         if (++shown == 20) {
+//             break; // cursor.offset() is right after insn
+//         }
+//     }
+class SweepCursor {
+  public:
+    SweepCursor(const uint8_t *decode, size_t size, uint32_t execOffset,
+                size_t offset = 0)
+        : decode(decode), size(size), execOffset(execOffset),
+          current(offset) {}
+
+    // Decodes the instruction at offset() and moves past it, false once the
+    // end of the image is reached
+    bool next(Instruction &insn);
+
+    // Offset of the next instruction, need not be a boundary of the sweep
+    // from 0
+    size_t offset() const { return current; }
+    void seek(size_t offset) { current = offset; }
+
+    bool done() const { return current >= size; }
+
+    // The bytes insn was decoded from
+    const uint8_t *bytes(const Instruction &insn) const {
+        return decode + (insn.address - execOffset);
+    }
+
+    class Iterator {
+      public:
+        explicit Iterator(SweepCursor *cursor) : cursor(cursor) {
+            ++*this;
+        }
+
+        const Instruction &operator*() const { return insn; }
+        const Instruction *operator->() const { return &insn; }
+
+        Iterator &operator++() {
+            if (cursor && !cursor->next(insn)) {
+                cursor = nullptr;
+            }
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) const {
+            return cursor != other.cursor;
+        }
+
+      private:
+        SweepCursor *cursor; // nullptr at the end
+        Instruction insn{};
+    };
+
+    Iterator begin() { return Iterator(this); }
+    Iterator end() { return Iterator(nullptr); }
+
+  private:
+    const uint8_t *decode;
+    size_t size;
+    uint32_t execOffset;
+    size_t current;
+};
+
+// Linear sweep over decode[0, size), one line per instruction
+void dec(const uint8_t *decode, size_t size, uint32_t execOffset, Output &out);
+
+// Linear sweep from the instruction boundary begin, printing every
+// instruction that starts before end. The last one may reach past end.
+void decRange(const uint8_t *decode, size_t size, size_t begin, size_t end,
+              uint32_t execOffset, Output &out);
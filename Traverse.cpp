@@ -0,0 +1,110 @@
+#include "Traverse.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Decoder.h"
+#include "Output.h"
+#include "Probe.h"
+
+std::vector<Reach> traverse(const uint8_t *decode, size_t size,
+                            uint32_t execOffset,
+                            const std::vector<uint32_t> &entries) {
+    std::vector<Reach> reach(size, Reach::DATA);
+    std::vector<size_t> work;
+
+    auto push = [&](uint32_t address) {
+        const size_t offset = address - execOffset;
+
+        if (address >= execOffset && offset < size) {
+            work.push_back(offset);
+        }
+    };
+
+    for (uint32_t entry : entries) {
+        push(entry);
+    }
+
+    while (!work.empty()) {
+        size_t offset = work.back();
+        work.pop_back();
+
+        while (offset < size && reach[offset] == Reach::DATA) {
+            Instruction insn;
+            decodeOP(decode + offset, size - offset, execOffset + offset,
+                     insn);
+
+            uint32_t target;
+            const Flow flow = getFlow(insn, target);
+
+            if (flow == Flow::INVALID) {
+                break;
+            }
+
+            bool overlaps = false;
+
+            for (size_t i = 1; i < insn.len; i++) {
+                overlaps = overlaps || reach[offset + i] != Reach::DATA;
+            }
+
+            if (overlaps) {
+                break;
+            }
+
+            reach[offset] = Reach::START;
+
+            for (size_t i = 1; i < insn.len; i++) {
+                reach[offset + i] = Reach::INSN;
+            }
+
+            if (flow == Flow::BRANCH || flow == Flow::JUMP ||
+                flow == Flow::CALL) {
+                push(target);
+            }
+
+            if (flow == Flow::JUMP || flow == Flow::JUMP_FAR ||
+                flow == Flow::JUMP_INDIRECT || flow == Flow::RETURN) {
+                break;
+            }
+
+            offset += insn.len;
+        }
+    }
+
+    return reach;
+}
+
+void decRecursive(const uint8_t *decode, size_t size, uint32_t execOffset,
+                  const std::vector<uint32_t> &entries, Output &out) {
+    const std::vector<Reach> reach =
+        traverse(decode, size, execOffset, entries);
+
+    size_t offset = 0;
+
+    while (offset < size) {
+        const uint8_t *cDecode = decode + offset;
+
+        if (reach[offset] == Reach::START) {
+            Instruction insn;
+            decodeOP(cDecode, size - offset, execOffset + offset, insn);
+            PROBE_STATUS(insn.status, insn.len);
+            out.put(insn, cDecode);
+
+            offset += insn.len;
+        } else {
+            size_t len = 1;
+
+            while (len < 4 && offset + len < size &&
+                   reach[offset + len] != Reach::START) {
+                len++;
+            }
+
+            PROBE_STATUS(Status::DB, len);
+            out.putData(execOffset + offset, cDecode, len);
+
+            offset += len;
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "Output.h"
+
+// Per byte of the image, filled in by traverse
+enum class Reach : uint8_t { DATA, START, INSN };
+
+// Recursive traversal: decodes from every entry address and follows jumps,
+// branches and calls with a worklist. Bytes of reached instructions are
+// marked START (first byte) or INSN, everything else stays DATA. Paths stop
+// at invalid instructions and at instructions overlapping earlier ones.
+std::vector<Reach> traverse(const uint8_t *decode, size_t size,
+                            uint32_t execOffset,
+                            const std::vector<uint32_t> &entries);
+
+// Prints the reached instructions, and everything else as data
+void decRecursive(const uint8_t *decode, size_t size, uint32_t execOffset,
+                  const std::vector<uint32_t> &entries, Output &out);
@@ -0,0 +1,122 @@
+#include "XRef.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Decoder.h"
+#include "Traverse.h"
+
+static const char *refKindNames[] = {"branch",   "jump",     "call",
+                                     "jump far", "call far", "data"};
+
+const char *getRefKindName(RefKind kind) {
+    return refKindNames[(size_t)kind];
+}
+
+// Listing addresses are linear
+static uint32_t getFarLinear(uint32_t target) {
+    return (target >> 16) * 16 + (target & 0xFFFF);
+}
+
+void XRefIndex::add(const Instruction &insn) {
+    uint32_t target;
+
+    // Data offsets are taken to be in the 64k segment of the instruction,
+    // like relative branch targets
+    const uint32_t segment = insn.address & ~0xFFFFu;
+
+    switch (getFlow(insn, target)) {
+    case Flow::BRANCH:
+        refs.push_back({target, insn.address, RefKind::BRANCH});
+        break;
+    case Flow::JUMP:
+        refs.push_back({target, insn.address, RefKind::JUMP});
+        break;
+    case Flow::CALL:
+        refs.push_back({target, insn.address, RefKind::CALL});
+        break;
+    case Flow::JUMP_FAR:
+        refs.push_back(
+            {getFarLinear(target), insn.address, RefKind::JUMP_FAR});
+        break;
+    case Flow::CALL_FAR:
+        refs.push_back(
+            {getFarLinear(target), insn.address, RefKind::CALL_FAR});
+        break;
+    case Flow::INVALID:
+        return;
+    default:
+        break;
+    }
+
+    for (const Operand &operand : insn.operands) {
+        switch (operand.type) {
+        case Type::DEREFBYTEATDW:
+        case Type::DEREFWORDATDW:
+            refs.push_back(
+                {segment | operand.val, insn.address, RefKind::DATA});
+            break;
+        case Type::RMB:
+        case Type::RMW:
+        case Type::RMDW:
+        case Type::RMQW:
+        case Type::MEM:
+            // [disp16] without base or index register
+            if (insn.mod == R_Type::NODISP && insn.rm == 0b110) {
+                refs.push_back(
+                    {segment | insn.disp, insn.address, RefKind::DATA});
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void XRefIndex::addSweep(const uint8_t *decode, size_t size,
+                         uint32_t execOffset) {
+    size_t offset = 0;
+
+    while (offset < size) {
+        Instruction insn;
+        offset += decodeOP(decode + offset, size - offset,
+                           execOffset + offset, insn);
+        add(insn);
+    }
+}
+
+void XRefIndex::addReached(const uint8_t *decode, size_t size,
+                           uint32_t execOffset,
+                           const std::vector<Reach> &reach) {
+    for (size_t offset = 0; offset < size; offset++) {
+        if (reach[offset] == Reach::START) {
+            Instruction insn;
+            decodeOP(decode + offset, size - offset, execOffset + offset,
+                     insn);
+            add(insn);
+        }
+    }
+}
+
+void XRefIndex::sort() {
+    std::sort(refs.begin(), refs.end(), [](const XRef &a, const XRef &b) {
+        return a.target != b.target ? a.target < b.target : a.from < b.from;
+    });
+}
+
+std::pair<const XRef *, const XRef *> XRefIndex::find(uint32_t begin,
+                                                      uint64_t end) const {
+    auto first = std::lower_bound(
+        refs.begin(), refs.end(), begin,
+        [](const XRef &ref, uint32_t target) { return ref.target < target; });
+    auto last = std::lower_bound(
+        first, refs.end(), end,
+        [](const XRef &ref, uint64_t target) { return ref.target < target; });
+
+    return {refs.data() + (first - refs.begin()),
+            refs.data() + (last - refs.begin())};
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "Decoder.h"
+#include "Traverse.h"
+
+enum class RefKind : uint8_t {
+    BRANCH,   // conditional jumps, LOOP and JCXZ
+    JUMP,     // near JMP
+    CALL,     // near CALL
+    JUMP_FAR, // target is segment * 16 + offset
+    CALL_FAR,
+    DATA // absolute memory operand, in the 64k segment of the instruction
+};
+
+struct XRef {
+    uint32_t target; // linear, like the addresses of the listing
+    uint32_t from; // address of the referencing instruction
+    RefKind kind;
+};
+
+// Who refers to an address: branch and call targets from getFlow plus the
+// direct addresses of memory operands. References are collected with add,
+// sort makes them queryable by target in O(log n).
+class XRefIndex {
+  public:
+    void add(const Instruction &insn);
+
+    // Adds every instruction of the linear sweep
+    void addSweep(const uint8_t *decode, size_t size, uint32_t execOffset);
+
+    // Adds the instructions traverse reached
+    void addReached(const uint8_t *decode, size_t size, uint32_t execOffset,
+                    const std::vector<Reach> &reach);
+
+    // Call after adding, before querying
+    void sort();
+
+    // References to targets in [begin, end), ordered by target then from
+    std::pair<const XRef *, const XRef *> find(uint32_t begin,
+                                               uint64_t end) const;
+
+    size_t size() const { return refs.size(); }
+
+  private:
+    std::vector<XRef> refs;
+};
+
+// Short name of the kind for listings
+const char *getRefKindName(RefKind kind);
@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Cpu.h"
+#include "Decoder.h"
+#include "Dos.h"
+#include "File.h"
+#include "Format.h"
+#include "Length.h"
+#include "Line.h"
+#include "Output.h"
+#include "Store.h"
+#include "Sweep.h"
+
+// Times the decoder stages separately over the given files plus a few
+// synthetic corpora. Every measurement is repeated, the median is reported
+// together with the spread of all runs around it.
+
+struct Corpus {
+    std::string name;
+    std::vector<uint8_t> data;
+    bool program; // A .COM file, also run by the interpreter
+
+    // From a linear sweep over data
+    std::vector<uint32_t> starts;
+    std::vector<Instruction> insns;
+};
+
+static const size_t syntheticSize = 1 << 20;
+
+// Each run goes over the corpus often enough to see at least this many bytes
+static const size_t bytesPerRun = 8 << 20;
+
+// Interpreter runs restart the program until this many steps have run
+static const uint64_t stepsPerRun = 1 << 20;
+
+// Keeps results alive so the compiler cannot drop the work
+static volatile size_t sink;
+
+static std::vector<uint8_t> randomBytes(std::mt19937 &rng, size_t size) {
+    std::vector<uint8_t> data(size);
+
+    for (uint8_t &b : data) {
+        b = (uint8_t)rng();
+    }
+
+    return data;
+}
+
+// ESC opcodes with every ModRM form, including the reserved ones
+static std::vector<uint8_t> fpuHeavy(std::mt19937 &rng, size_t size) {
+    std::vector<uint8_t> data;
+    data.reserve(size + 4);
+
+    while (data.size() < size) {
+        const uint8_t modrm = (uint8_t)rng();
+
+        data.push_back((uint8_t)(0xD8 + rng() % 8));
+        data.push_back(modrm);
+
+        const R_Type mod = (R_Type)(modrm >> 6);
+        const size_t disp = (size_t)getDispMemWidth(modrm & 0b111, mod);
+
+        for (size_t i = 0; i < disp; i++) {
+            data.push_back((uint8_t)rng());
+        }
+    }
+
+    data.resize(size);
+    return data;
+}
+
+// Runs of segment override, LOCK and REP prefixes in front of moves and
+// string instructions
+static std::vector<uint8_t> prefixHeavy(std::mt19937 &rng, size_t size) {
+    static const uint8_t prefixes[] = {0x26, 0x2E, 0x36, 0x3E,
+                                       0xF0, 0xF2, 0xF3};
+    static const uint8_t strings[] = {0xA4, 0xA5, 0xA6, 0xA7,
+                                      0xAA, 0xAB, 0xAC, 0xAD};
+
+    std::vector<uint8_t> data;
+    data.reserve(size + 8);
+
+    while (data.size() < size) {
+        const size_t count = 1 + rng() % 3;
+
+        for (size_t i = 0; i < count; i++) {
+            data.push_back(prefixes[rng() % sizeof(prefixes)]);
+        }
+
+        if (rng() % 2) {
+            data.push_back(strings[rng() % sizeof(strings)]);
+            continue;
+        }
+
+        const uint8_t modrm = (uint8_t)rng();
+
+        data.push_back((uint8_t)(0x88 + rng() % 4));
+        data.push_back(modrm);
+
+        const R_Type mod = (R_Type)(modrm >> 6);
+        const size_t disp = (size_t)getDispMemWidth(modrm & 0b111, mod);
+
+        for (size_t i = 0; i < disp; i++) {
+            data.push_back((uint8_t)rng());
+        }
+    }
+
+    data.resize(size);
+    return data;
+}
+
+static void sweep(Corpus &corpus) {
+    const std::vector<uint8_t> &data = corpus.data;
+    size_t offset = 0;
+
+    while (offset < data.size()) {
+        Instruction insn;
+        decodeOP(data.data() + offset, data.size() - offset, 0x100 + offset,
+                 insn);
+
+        corpus.starts.push_back(offset);
+        corpus.insns.push_back(insn);
+        offset += insn.len;
+    }
+}
+
+struct Stats {
+    double median;
+    double spread; // Largest deviation from the median, relative
+};
+
+template <typename F> static Stats measure(size_t reps, F f) {
+    std::vector<double> times;
+
+    for (size_t i = 0; i < reps; i++) {
+        const auto begin = std::chrono::steady_clock::now();
+        f();
+        const auto end = std::chrono::steady_clock::now();
+
+        times.push_back(std::chrono::duration<double>(end - begin).count());
+    }
+
+    std::sort(times.begin(), times.end());
+
+    Stats stats;
+    stats.median = times[times.size() / 2];
+    stats.spread = std::max(stats.median - times.front(),
+                            times.back() - stats.median) /
+                   stats.median;
+
+    return stats;
+}
+
+static void report(const char *stage, const Corpus &corpus, size_t loops,
+                   const Stats &stats) {
+    const double bytes = (double)corpus.data.size() * loops;
+    const double insns = (double)corpus.insns.size() * loops;
+
+    printf("%-18s %-14s %10.1f MB/s %10.2f Minsn/s  +-%5.1f%%\n", stage,
+           corpus.name.c_str(), bytes / stats.median / 1e6,
+           insns / stats.median / 1e6, stats.spread * 100);
+}
+
+// Runs the program again and again on one Cpu, so the cached blocks of a
+// run are there for the next one like in a long running program
+static void benchInterpreter(const Corpus &corpus, size_t reps, bool blocks) {
+    static const uint16_t comSegment = 0x1000;
+
+    Cpu cpu;
+    cpu.onInterrupt = [](Cpu &c, uint8_t vector) {
+        return dosInterrupt(c, vector, nullptr);
+    };
+
+    uint64_t steps = 0;
+
+    const Stats stats = measure(reps, [&]() {
+        steps = 0;
+
+        while (steps < stepsPerRun) {
+            cpu.loadCom(corpus.data.data(), corpus.data.size(), comSegment);
+
+            const uint64_t before = cpu.steps;
+            cpu.run(stepsPerRun - steps, blocks);
+
+            if (cpu.steps == before) {
+                break;
+            }
+
+            steps += cpu.steps - before;
+        }
+    });
+
+    if (steps == 0) {
+        return;
+    }
+
+    printf("%-18s %-14s %15s %10.2f Minsn/s  +-%5.1f%%\n",
+           blocks ? "run (blocks)" : "run (decode)", corpus.name.c_str(), "",
+           (double)steps / stats.median / 1e6, stats.spread * 100);
+}
+
+static void bench(const Corpus &corpus, size_t reps, int devNull) {
+    const uint8_t *data = corpus.data.data();
+    const size_t size = corpus.data.size();
+    const size_t loops = std::max<size_t>(1, bytesPerRun / size);
+
+    Stats stats = measure(reps, [&]() {
+        size_t found = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            for (uint32_t start : corpus.starts) {
+                found += getOP(data + start, size - start) != nullptr;
+            }
+        }
+
+        sink = found;
+    });
+    report("getOP", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        size_t len = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            for (size_t i = 0; i < corpus.insns.size(); i++) {
+                const Instruction &insn = corpus.insns[i];
+
+                if (insn.status == Status::OP) {
+                    len += getLen(*(insn.op->description),
+                                  data + corpus.starts[i] + insn.op->codeSz);
+                }
+            }
+        }
+
+        sink = len;
+    });
+    report("getLen", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        size_t len = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            size_t offset = 0;
+
+            while (offset < size) {
+                Instruction insn;
+                offset += decodeOP(data + offset, size - offset, offset, insn);
+                len += insn.len;
+            }
+        }
+
+        sink = len;
+    });
+    report("decodeOP", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        size_t count = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            count += getBoundaries(data, size).size();
+        }
+
+        sink = count;
+    });
+    report("getBoundaries", corpus, loops, stats);
+
+    InstructionStore store(0x100);
+    storeSweep(data, size, 0x100, store);
+
+    stats = measure(reps, [&]() {
+        size_t count = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            InstructionStore built(0x100);
+            storeSweep(data, size, 0x100, built);
+            count += built.size();
+        }
+
+        sink = count;
+    });
+    report("storeSweep", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        size_t len = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            for (size_t i = 0; i < store.size(); i++) {
+                Instruction insn;
+                store.get(i, insn);
+                len += insn.len;
+            }
+        }
+
+        sink = len;
+    });
+    report("store get", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        size_t len = 0;
+
+        for (size_t l = 0; l < loops; l++) {
+            for (const Instruction &insn : corpus.insns) {
+                if (insn.status == Status::OP) {
+                    Line line{};
+                    printDescription(insn, line);
+                    len += line.len;
+                }
+            }
+        }
+
+        sink = len;
+    });
+    report("printDescription", corpus, loops, stats);
+
+    stats = measure(reps, [&]() {
+        Output out(devNull, true);
+
+        for (size_t l = 0; l < loops; l++) {
+            dec(data, size, 0x100, out);
+        }
+
+        out.flush();
+    });
+    report("dec", corpus, loops, stats);
+
+    if (corpus.program) {
+        benchInterpreter(corpus, reps, false);
+        benchInterpreter(corpus, reps, true);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t reps = 11;
+    std::vector<Corpus> corpora;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+            continue;
+        }
+
+        try {
+            const FileDescriptorRO rofd(argv[i]);
+
+            Corpus corpus;
+            corpus.name = argv[i];
+            corpus.data = getBuffer(rofd.fd);
+            corpus.program = true;
+            corpora.push_back(std::move(corpus));
+        } catch (...) {
+            printf("Skipping %s\n", argv[i]);
+        }
+    }
+
+    // Fixed seed, every run sees the same bytes
+    std::mt19937 rng(286);
+
+    corpora.push_back(
+        {"random", randomBytes(rng, syntheticSize), false, {}, {}});
+    corpora.push_back({"fpu", fpuHeavy(rng, syntheticSize), false, {}, {}});
+    corpora.push_back(
+        {"prefix", prefixHeavy(rng, syntheticSize), false, {}, {}});
+
+    const int devNull = open("/dev/null", O_WRONLY);
+
+    if (devNull == -1) {
+        printf("Cannot open /dev/null\n");
+        return -1;
+    }
+
+    for (Corpus &corpus : corpora) {
+        if (corpus.data.empty()) {
+            continue;
+        }
+
+        sweep(corpus);
+        bench(corpus, reps, devNull);
+    }
+
+    close(devNull);
+    return 0;
+}
@@ -6,4 +6,7 @@ echo "[" > compile_commands.json
 cat compile_commands.json.temp >> compile_commands.json
 echo "]" >> compile_commands.json
 
-clang-tidy --quiet dmask.cpp File.cpp
+clang-tidy --quiet dmask.cpp Assembler.cpp Batch.cpp Cpu.cpp Decoder.cpp \
+    DecodeCache.cpp Dos.cpp File.cpp Format.cpp Graph.cpp Hex.cpp Length.cpp \
+    Output.cpp Parallel.cpp Patch.cpp Probe.cpp Record.cpp Seek.cpp Stats.cpp \
+    Store.cpp Sweep.cpp Search.cpp Traverse.cpp XRef.cpp
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Decoder.h"
+#include "Format.h"
+#include "Line.h"
+
+// Differential test against objdump -m i8086. Every first byte is combined
+// with every second byte, and every 0F xx with every third byte, which
+// covers all opcodes, ModRM bytes and displacement sizes. Each case sits in
+// its own slot, the remaining bytes are NOPs: they fill in immediates and
+// displacements and let objdump get back in step when it reads a different
+// length. Lengths and a signature of the text (mnemonic, registers and
+// memory operand widths) are compared. Differences are printed grouped by
+// opcode, make verify diffs them against verify.expected.
+
+static const size_t slotSize = 16;
+static const uint8_t fill = 0x90;
+
+struct Case {
+    uint8_t bytes[3];
+};
+
+struct Mismatch {
+    size_t index;
+    bool length;
+    std::string ours;
+    std::string theirs;
+};
+
+// objdump's view of one slot
+struct Reference {
+    size_t len; // 0 if no instruction starts at the slot
+    std::string text;
+};
+
+static std::vector<Case> enumerate() {
+    std::vector<Case> cases;
+
+    for (size_t b0 = 0; b0 < 256; b0++) {
+        for (size_t b1 = 0; b1 < 256; b1++) {
+            if (b0 != 0x0F) {
+                cases.push_back({{(uint8_t)b0, (uint8_t)b1, fill}});
+                continue;
+            }
+
+            for (size_t b2 = 0; b2 < 256; b2++) {
+                cases.push_back({{(uint8_t)b0, (uint8_t)b1, (uint8_t)b2}});
+            }
+        }
+    }
+
+    return cases;
+}
+
+// Slot i of image is at address (first + i) * slotSize
+static bool disassemble(const std::vector<uint8_t> &image, size_t first,
+                        std::vector<Reference> &refs) {
+    char path[] = "/tmp/dmask286-verify-XXXXXX";
+    const int fd = mkstemp(path);
+
+    if (fd == -1) {
+        return false;
+    }
+
+    const bool written =
+        write(fd, image.data(), image.size()) == (ssize_t)image.size();
+    close(fd);
+
+    const std::string command = "objdump -D -b binary -m i8086 -M intel "
+                                "--insn-width=16 --adjust-vma=" +
+                                std::to_string(first * slotSize) + " " + path;
+    FILE *pipe = written ? popen(command.c_str(), "r") : nullptr;
+
+    if (!pipe) {
+        unlink(path);
+        return false;
+    }
+
+    char buf[512];
+
+    while (fgets(buf, sizeof(buf), pipe)) {
+        // "  1f0:\t0f 01 e0   \tsmsw   ax"
+        char *end;
+        const size_t address = strtoul(buf, &end, 16);
+
+        if (end == buf || end[0] != ':' || end[1] != '\t' ||
+            address % slotSize != 0 || address / slotSize < first ||
+            address / slotSize - first >= refs.size()) {
+            continue;
+        }
+
+        const char *hex = end + 2;
+        const char *text = strchr(hex, '\t');
+
+        if (!text) {
+            continue;
+        }
+
+        Reference &ref = refs[address / slotSize - first];
+        ref.len = 0;
+
+        for (const char *c = hex; c < text; c++) {
+            ref.len += isxdigit((unsigned char)c[0]) && c[1] == ' ';
+        }
+
+        ref.text = text + 1;
+        ref.text.erase(ref.text.find_last_not_of(" \n") + 1);
+    }
+
+    const bool ok = pclose(pipe) == 0;
+    unlink(path);
+
+    return ok;
+}
+
+// Mnemonic, registers and memory operands in order, lower case, with the
+// names of both disassemblers mapped to one spelling. Memory operands are
+// "m" followed by the width if the text gives one.
+static std::vector<std::string> signature(const std::string &text) {
+    static const std::map<std::string, std::string> aliases = {
+        {"sal", "shl"},     {"jnae", "jb"},       {"jc", "jb"},
+        {"jnb", "jae"},     {"jnc", "jae"},       {"jz", "je"},
+        {"jnz", "jne"},     {"jna", "jbe"},       {"jnbe", "ja"},
+        {"jpe", "jp"},      {"jpo", "jnp"},       {"jnge", "jl"},
+        {"jnl", "jge"},     {"jng", "jle"},       {"jnle", "jg"},
+        {"loope", "loopz"}, {"loopne", "loopnz"}, {"repe", "repz"},
+        {"repne", "repnz"}, {"fwait", "wait"},    {"xlatb", "xlat"}};
+
+    static const char *const registers[] = {
+        "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh", "ax", "cx",
+        "dx", "bx", "sp", "bp", "si", "di", "es", "cs", "ss", "ds"};
+
+    // objdump spells out the implicit operands of these
+    static const char *const strings[] = {"movs", "cmps", "stos", "lods",
+                                          "scas", "ins",  "outs"};
+
+    std::vector<std::string> words;
+    std::string word;
+
+    for (char c : text + " ") {
+        if (isalnum((unsigned char)c)) {
+            word += (char)tolower((unsigned char)c);
+            continue;
+        }
+
+        // A segment like in ds:0x9090 only says it is a memory operand, the
+        // colon of far pointers does not
+        const bool segment = c == ':' && word.size() == 2 && word[1] == 's';
+
+        if (segment) {
+            words.push_back(":");
+        } else if (!word.empty()) {
+            words.push_back(word);
+        }
+
+        word.clear();
+
+        if (c == '[' && (words.empty() || words.back() != ":")) {
+            words.push_back("[");
+        }
+    }
+
+    std::vector<std::string> res;
+    std::string width;
+
+    for (size_t i = 0; i < words.size(); i++) {
+        std::string w = words[i];
+
+        const bool prefixed =
+            i == 1 && (words[0] == "rep" || words[0] == "repz" ||
+                       words[0] == "repnz" || words[0] == "repe" ||
+                       words[0] == "repne" || words[0] == "lock");
+
+        if (i == 0 || prefixed) {
+            auto it = aliases.find(w);
+            res.push_back(it != aliases.end() ? it->second : w);
+            continue;
+        }
+
+        const bool reg =
+            std::find_if(std::begin(registers), std::end(registers),
+                         [&](const char *r) { return w == r; }) !=
+            std::end(registers);
+
+        if (w == "st") {
+            // ST, ST1 and st(1) all become st0 to st7
+            const bool index = i + 1 < words.size() &&
+                               words[i + 1].size() == 1 &&
+                               isdigit((unsigned char)words[i + 1][0]);
+            res.push_back(index ? "st" + words[++i] : "st0");
+        } else if (w.size() == 3 && w[0] == 's' && w[1] == 't' &&
+                   isdigit((unsigned char)w[2])) {
+            res.push_back(w);
+        } else if (w == "byte" || w == "word" || w == "dword" ||
+                   w == "qword" || w == "tbyte") {
+            width = w;
+        } else if (w == "[" || w == ":") {
+            res.push_back(width.empty() ? "m" : "m " + width);
+            width.clear();
+        } else if (reg) {
+            res.push_back(w);
+        }
+    }
+
+    if (res.empty()) {
+        return res;
+    }
+
+    const bool rep = res.size() > 1 && (res[0] == "rep" || res[0] == "repz" ||
+                                         res[0] == "repnz");
+    std::string &mnemonic = res[rep ? 1 : 0];
+
+    const bool string =
+        std::find_if(std::begin(strings), std::end(strings),
+                     [&](const char *s) { return mnemonic == s; }) !=
+        std::end(strings);
+
+    if (string || mnemonic == "xlat") {
+        // Only the width of the implicit operands remains
+        bool wide = false;
+
+        for (const std::string &t : res) {
+            wide = wide || t == "m word" || t == "ax";
+        }
+
+        if (string) {
+            mnemonic += wide ? "w" : "b";
+        }
+
+        res.resize(rep ? 2 : 1);
+    }
+
+    return res;
+}
+
+// Equal, except a memory operand without width matches any width
+static bool same(const std::vector<std::string> &a,
+                 const std::vector<std::string> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); i++) {
+        const bool memory = a[i][0] == 'm' && b[i][0] == 'm' &&
+                            (a[i] == "m" || b[i] == "m");
+
+        if (a[i] != b[i] && !memory) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void compare(const std::vector<Case> &cases, size_t begin, size_t end,
+                    std::vector<Mismatch> &mismatches, bool &failed) {
+    std::vector<uint8_t> image((end - begin) * slotSize, fill);
+
+    for (size_t i = begin; i < end; i++) {
+        memcpy(&image[(i - begin) * slotSize], cases[i].bytes, 3);
+    }
+
+    std::vector<Reference> refs(end - begin);
+
+    if (!disassemble(image, begin, refs)) {
+        failed = true;
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        const uint8_t *slot = &image[(i - begin) * slotSize];
+
+        Instruction insn;
+        decodeOP(slot, slotSize, (uint32_t)(i * slotSize), insn);
+
+        Line line{};
+
+        switch (insn.status) {
+        case Status::OP:
+            line << insn.op->name;
+            printDescription(insn, line);
+            break;
+        case Status::FPU_RESERVED:
+            line << "FPU RESERVED";
+            break;
+        default:
+            line << "DB";
+            break;
+        }
+
+        const std::string ours(line.text, line.len);
+        const Reference &ref = refs[i - begin];
+
+        if (ref.len != insn.len) {
+            mismatches.push_back({i, true, ours, ref.text});
+        } else if (!same(signature(ours), signature(ref.text))) {
+            mismatches.push_back({i, false, ours, ref.text});
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    if (argc == 3 && strcmp(argv[1], "-j") == 0) {
+        threads = std::max(atoi(argv[2]), 1);
+    } else if (argc != 1) {
+        printf("Use %s [-j threads]\n", argv[0]);
+        return -1;
+    }
+
+    const std::vector<Case> cases = enumerate();
+
+    // Several chunks per thread so a slow one does not hold up the rest
+    const size_t chunks = threads * 4;
+    const size_t chunkSize = (cases.size() + chunks - 1) / chunks;
+
+    std::vector<std::vector<Mismatch>> results(chunks);
+    std::vector<char> failures(chunks);
+    std::mutex mutex;
+    size_t next = 0;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t c;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (next >= chunks) {
+                    return;
+                }
+
+                c = next++;
+            }
+
+            const size_t begin = std::min(cases.size(), c * chunkSize);
+            const size_t end = std::min(cases.size(), begin + chunkSize);
+            bool failed = false;
+
+            compare(cases, begin, end, results[c], failed);
+            failures[c] = failed;
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+
+    for (std::thread &t : workers) {
+        t.join();
+    }
+
+    if (std::find(failures.begin(), failures.end(), true) != failures.end()) {
+        printf("Running objdump failed\n");
+        return -1;
+    }
+
+    // Opcode, kind and our mnemonic, with the count and the first case
+    typedef std::tuple<std::string, bool, std::string> Key;
+    std::map<Key, std::pair<size_t, const Mismatch *>> groups;
+    size_t total = 0;
+
+    for (const std::vector<Mismatch> &result : results) {
+        for (const Mismatch &m : result) {
+            const uint8_t *b = cases[m.index].bytes;
+
+            const std::vector<std::string> ours = signature(m.ours);
+            const std::string mnemonic = ours.empty() ? "" : ours[0];
+
+            // Later CPUs filled most of the two byte opcodes the 286 does
+            // not have, one group for all of them is enough
+            char opcode[8];
+            snprintf(opcode, sizeof(opcode), "%02X", b[0]);
+
+            if (b[0] == 0x0F && mnemonic != "db") {
+                snprintf(opcode, sizeof(opcode), "0F %02X", b[1]);
+            }
+
+            const Key key{opcode, m.length, mnemonic};
+
+            auto &group = groups[key];
+
+            if (group.first++ == 0) {
+                group.second = &m;
+            }
+
+            total++;
+        }
+    }
+
+    for (const auto &group : groups) {
+        const Mismatch &m = *group.second.second;
+        const uint8_t *b = cases[m.index].bytes;
+
+        printf("%-5s %-6s %6zu  %02X %02X %02X  %s | %s\n",
+               std::get<0>(group.first).c_str(),
+               std::get<1>(group.first) ? "length" : "text",
+               group.second.first, b[0], b[1], b[2], m.ours.c_str(),
+               m.theirs.c_str());
+    }
+
+    printf("%zu of %zu cases differ in %zu groups\n", total, cases.size(),
+           groups.size());
+
+    return 0;
+}